@@ -8,6 +8,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
 
 #define INSERT_OP      0x01
 #define DELETE_OP      0x02
@@ -20,25 +26,193 @@
 #define SUBSTITUTE_COST   1
 #define TRANSPOSE_COST   1
 
-// 재귀적으로 연산자 행렬을 순회하며, 두 문자열이 최소편집거리를 갖는 모든 가능한 정렬(alignment) 결과를 출력한다.
-// op_matrix : 이전 상태의 연산자 정보가 저장된 행렬 (1차원 배열임에 주의!)
-// col_size : op_matrix의 열의 크기
+#define COST_NO_TRANSPOSE   -1  // 비용 모델의 trans가 이 값이면 전위 연산을 쓰지 않음
+
+#define BATCH_PAIRS   65536     // 배치 모드에서 한 번에 읽어 처리하는 쌍의 수
+#define BATCH_CHUNK   64        // 스레드가 한 번에 가져가는 쌍의 최대 수 (작업 단위)
+#define MAX_THREADS   64
+#define OUTBUF_SIZE   (1 << 20) // 출력 버퍼의 크기
+#define MAX_ALIGNMENTS   100    // min_editdistance가 출력하는 최적 정렬의 최대 수
+#define READ_BLOCK_SIZE  (1 << 20) // 입력을 읽는 블록의 크기
+
+#define BENCH_MIN_TIME     0.2         // 벤치마크에서 커널 하나를 반복해 재는 최소 시간 (초)
+#define BENCH_MAX_CELLS    (1LL << 31) // 벤치마크에서 이보다 많은 칸을 계산해야 하는 커널은 건너뜀
+#define BENCH_MAX_MATRIX   (1LL << 28) // 벤치마크에서 연산자 행렬(칸마다 한 바이트)의 최대 크기
+
+// 실행 중에 정하는 비용 모델 (함수에 NULL을 넘기면 위의 INSERT_COST, ... 로 정한 기본 비용)
+// 비용은 0 이상이고 삽입, 삭제 비용은 1 이상이어야 한다.
+typedef struct {
+   int ins, del, sub;
+   int trans;                  // 전위 비용, COST_NO_TRANSPOSE이면 전위 연산 없음
+   int *matrix;                // 256 x 256 교체 비용 (matrix[a * 256 + b] : str1의 a와 str2의 b, 일치 포함), NULL이면 sub
+} COST_MODEL;
+
+// 사전 단어들의 트라이, 자식은 문자 순으로 정렬된 연결 리스트
+typedef struct TRIE_NODE {
+   struct TRIE_NODE *child;    // 첫 번째 자식
+   struct TRIE_NODE *sibling;  // 다음 형제 (더 큰 문자)
+   int word;                   // 이 노드에서 끝나는 단어의 번호, 없으면 -1
+   unsigned char ch;
+} TRIE_NODE;
+
+typedef struct {
+   TRIE_NODE root;
+   char **words;               // 번호순 단어
+   int num_words;
+   int capacity;
+   int max_len;                // 가장 긴 단어의 길이 (검색할 때 DP 행의 수)
+} TRIE;
+
+// 검색 결과 (word는 트라이 안의 단어를 가리킴)
+typedef struct {
+   const char *word;
+   int distance;
+} TRIE_MATCH;
+
+// 정렬 반복자의 스택 한 칸 (경로 위의 칸 (i, j)와 아직 따라가 보지 않은 연산들)
+typedef struct {
+   int i, j;
+   unsigned char rest;
+   char op;                    // 이 칸에서 고른 연산 (M, S, I, D, T)
+} ALIGN_FRAME;
+
+// op_matrix의 최적 정렬을 하나씩 돌려주는 반복자 (명시적 스택으로 깊이 우선 탐색)
+typedef struct {
+   const unsigned char *op_matrix;
+   int col_size;
+   ALIGN_FRAME *stack;         // (n, m)에서 (0, 0)까지의 경로, 최대 n + m + 1칸
+   int depth;
+   long long count;            // 지금까지 돌려준 정렬의 수
+   long long limit;            // 돌려줄 정렬의 최대 수 (0이면 제한 없음)
+} ALIGN_ITER;
+
+// 두 문자열 str1과 str2의 연산자 행렬을 만든다. 칸마다 이전 상태로 가는 연산자 비트(INSERT_OP, ...)를 한 바이트에 저장
+// d는 최근 세 행만 유지하므로 메모리는 (n + 1) * (m + 1) 바이트 + O(m)
+// distance : 최소편집거리
+// return value : 연산자 행렬 (1차원 배열, 열의 크기 m + 1, 호출한 쪽에서 free), 메모리가 부족하면 NULL
+unsigned char *min_editdistance_matrix( char *str1, char *str2, const COST_MODEL *cost, int *distance);
+
+// op_matrix의 최적 정렬을 (n, m)부터 하나씩 돌려주는 반복자를 준비한다.
+// 교체/일치, 삽입, 삭제, 전위 순으로 따라가며, 메모리는 경로의 길이 O(n + m)뿐이다.
+// limit : 돌려줄 정렬의 최대 수 (0이면 제한 없음)
+// return value : 성공 0, 메모리가 부족하면 -1
+int align_iter_init( ALIGN_ITER *it, const unsigned char *op_matrix, int col_size, int n, int m, long long limit);
+
+// 다음 최적 정렬을 구한다.
+// ops : 정렬의 연산을 앞에서부터 차례로 저장 (길이 n+m+1 이상), 일치:M, 교체:S, 삽입:I, 삭제:D, 전위:T
+// return value : 정렬이 있으면 1, 더 없거나 limit에 도달하면 0
+int align_iter_next( ALIGN_ITER *it, char *ops);
+
+void align_iter_free( ALIGN_ITER *it);
+
+// op_matrix의 최적 정렬의 수를 정렬을 만들지 않고 센다. (세 행만 유지하는 경로 수 DP)
+// cap : 이 값에서 세기를 멈춤 (0이면 LLONG_MAX)
+// return value : 최적 정렬의 수 (cap 이하)
+long long align_count( const unsigned char *op_matrix, int col_size, int n, int m, long long cap);
+
+// op_matrix의 최적 정렬을 최대 MAX_ALIGNMENTS개까지 출력하고 전체 수를 알려준다.
 // str1 : 문자열 1
 // str2 : 문자열 2
 // n : 문자열 1의 길이
 // m : 문자열 2의 길이
-// level : 재귀호출의 레벨 (0, 1, 2, ...)
-// align_str : 정렬된 문자쌍들의 정보가 저장된 문자열 배열 예) "a - a", "a - b", "* - b", "ab - ba"
-static void backtrace_main( int *op_matrix, int col_size, char *str1, char *str2, int n, int m, int level, char align_str[][8]);
+void backtrace( const unsigned char *op_matrix, int col_size, char *str1, char *str2, int n, int m);
 
 // 강의 자료의 형식대로 op_matrix를 출력 (좌하단(1,1) -> 우상단(n, m))
 // 각 연산자를 다음과 같은 기호로 표시한다. 삽입:I, 삭제:D, 교체:S, 일치:M, 전위:T
-void print_matrix( int *op_matrix, int col_size, char *str1, char *str2, int n, int m);
+void print_matrix( const unsigned char *op_matrix, int col_size, char *str1, char *str2, int n, int m);
 
 // 두 문자열 str1과 str2의 최소편집거리를 계산한다.
-// return value : 최소편집거리
+// return value : 최소편집거리, 메모리가 부족하면 -1
 // 이 함수 내부에서 print_matrix 함수와 backtrace 함수를 호출함
-int min_editdistance( char *str1, char *str2);
+int min_editdistance( char *str1, char *str2, const COST_MODEL *cost);
+
+// 두 문자열 str1과 str2의 최소편집거리만 계산한다. (연산자 행렬과 정렬은 만들지 않음)
+// 짧은 문자열을 열로 두고 최근 세 행만 유지하므로 메모리는 O(min(n, m)) (전위 연산이 d[i-2][j-2]를 참조하므로 세 행)
+// 문자열의 길이에 제한이 없으며 작업 공간은 힙에 할당한다.
+// 교체 비용 행렬과 전위 연산의 유무에 따라 따로 펼친 네 가지 루프 중 하나를 쓴다.
+// return value : 최소편집거리, 메모리가 부족하면 -1
+int min_editdistance_linear( char *str1, char *str2, const COST_MODEL *cost);
+
+// 두 문자열 str1과 str2의 최적 정렬 하나를 선형 메모리로 구한다. (Hirschberg 분할 정복)
+// ops : 정렬의 연산을 앞에서부터 차례로 저장 (길이 n+m+1 이상), 일치:M, 교체:S, 삽입:I, 삭제:D, 전위:T
+// 가운데 행에서 최적 경로가 지나는 열을 찾아 두 부분 문제로 나누며, 가운데 행을 건너뛰는 전위 연산도 고려한다.
+// 메모리는 O(n + m), 시간은 전체 행렬을 채울 때의 약 2배
+// return value : 최소편집거리, 메모리가 부족하면 -1
+int min_editdistance_align( char *str1, char *str2, const COST_MODEL *cost, char *ops);
+
+// min_editdistance_align의 결과를 정렬된 문자쌍 형식으로 출력 예) "a - a", "a - b", "* - b", "ab - ba"
+void print_ops( char *str1, char *str2, char *ops);
+
+// 모든 비용이 1일 때 두 문자열 str1과 str2의 최소편집거리를 비트 병렬(Myers/Hyyrö)로 계산한다.
+// 짧은 문자열(패턴)의 행들을 64비트 워드의 비트로 두고 긴 문자열의 문자마다 한 열을 워드 연산으로 갱신한다.
+// 전위 연산은 Hyyrö의 확장으로 처리하며, 패턴이 64자보다 길면 여러 워드에 걸쳐 자리올림과 시프트를 전달한다.
+// 전위 연산이 없는 비용 모델이면 전위 항을 빼고 Myers의 원래 알고리즘이 된다.
+// 시간은 O(n * ceil(min(n, m) / 64)), 비용이 1이 아니면 min_editdistance_dispatch를 호출
+// return value : 최소편집거리, 메모리가 부족하면 -1
+int min_editdistance_bitparallel( char *str1, char *str2, const COST_MODEL *cost);
+
+// 두 문자열 str1과 str2의 최소편집거리가 k 이하인지 판정한다. (Ukkonen의 대각 띠)
+// 대각선 j - i가 -k / 삭제 비용 ~ k / 삽입 비용인 띠(단위 비용이면 폭 2k+1)만 계산하고
+// 한 행의 모든 값이 k보다 커지면 바로 끝낸다. 시간은 O(k * n), 메모리는 O(k)
+// return value : 최소편집거리 (k 이하), k보다 크면 k + 1, 메모리가 부족하면 -1
+int min_editdistance_bounded( char *str1, char *str2, const COST_MODEL *cost, int k);
+
+// 두 문자열 str1과 str2의 가중치 최소편집거리를 반대각선(i + j = d) 단위로 계산한다.
+// 한 반대각선의 칸들은 서로 독립이므로 AVX2(8칸) 또는 SSE4.1(4칸)로 한 번에 계산하고, 지원하지 않는 CPU에서는 한 칸씩 계산
+// str2를 뒤집어 두어 반대각선을 따라 두 문자열을 모두 연속으로 읽으며, 전위 연산은 반대각선 d-4에서 가져온다.
+// 메모리는 반대각선 다섯 개, O(min(n, m)), 교체 비용 행렬이 있으면 min_editdistance_linear를 호출
+// return value : 최소편집거리, 메모리가 부족하면 -1
+int min_editdistance_simd( char *str1, char *str2, const COST_MODEL *cost);
+
+// 비용 모델에 맞는 가장 빠른 커널로 최소편집거리를 계산한다.
+// 모든 비용이 1 (전위 없음 포함) : min_editdistance_bitparallel, 교체 비용 행렬이 없으면 : min_editdistance_simd,
+// 그 밖 : min_editdistance_linear (행렬과 전위 연산의 유무로 특수화된 루프)
+// return value : 최소편집거리, 메모리가 부족하면 -1
+int min_editdistance_dispatch( char *str1, char *str2, const COST_MODEL *cost);
+
+// "ins,del,sub,trans" 형식의 문자열로 비용 모델을 정한다. trans가 "-"이면 전위 연산 없음
+// return value : 성공 0, 형식이 틀리거나 비용이 범위 밖이면 -1
+int cost_model_parse( COST_MODEL *cost, const char *spec);
+
+// 파일에서 교체 비용 행렬을 읽는다. 한 줄에 "a b 비용" (a, b는 한 문자), 적지 않은 쌍은 같으면 0, 다르면 sub
+// return value : 성공 0, 실패 -1
+int cost_model_load_matrix( COST_MODEL *cost, const char *path);
+
+void cost_model_free( COST_MODEL *cost);
+
+// stdin의 "문자열1\t문자열2" 줄들을 BATCH_PAIRS개씩 읽어 num_threads개의 스레드로 최소편집거리를 계산하고
+// 입력 순서대로 한 줄에 하나씩 출력한다. align이면 "거리\t연산" 형식으로 정렬(M/S/I/D/T)도 출력
+// 배치를 BATCH_CHUNK 쌍의 작업으로 나누어 스레드마다 덱(deque)에 나눠 주고, 자기 덱이 비면 다른 스레드의 덱 뒤쪽에서 훔쳐 온다.
+// return value : 성공 0, 실패 -1
+int min_editdistance_batch( int num_threads, int align, const COST_MODEL *cost);
+
+// 빈 트라이를 만든다.
+// return value : 트라이, 메모리가 부족하면 NULL
+TRIE *trie_create( void);
+
+// 트라이에 단어를 넣는다. 이미 있는 단어면 그 번호를 돌려준다.
+// return value : 단어의 번호, 메모리가 부족하면 -1
+int trie_insert( TRIE *trie, const char *word);
+
+// query와의 최소편집거리 min_editdistance(query, 단어)가 k 이하인 단어들을 찾는다.
+// topk가 0보다 크면 가장 가까운 topk개만 찾는다. (거리가 같으면 사전순으로 앞선 단어)
+// 트라이를 깊이 우선으로 내려가며 단어의 i번째 문자에 대한 DP 행을 부모의 행(과 전위 연산을 위한 조부모의 행)에서 계산하므로
+// 공통 접두사의 행은 한 번만 계산한다. 행 i와 i-1의 최소값이 한계(k 또는 현재 topk번째 거리)를 넘으면 그 아래는 건너뛴다.
+// matches : 거리, 사전순으로 정렬된 결과 (호출한 쪽에서 free)
+// return value : 결과의 수, 메모리가 부족하면 -1
+int trie_search( TRIE *trie, const char *query, const COST_MODEL *cost, int k, int topk, TRIE_MATCH **matches);
+
+// 트라이와 단어들을 해제한다.
+void trie_destroy( TRIE *trie);
+
+// 임의로 만든 문자열 쌍으로 커널마다 최소편집거리를 계산하는 시간을 재어 결과를 TSV로 outfp에 출력한다. (결과는 출력하지 않음)
+// 알파벳(DNA, ASCII, 바이트) x 길이 x 변이율(0.1%, 1%, 10%, 서로 무관한 문자열)마다 str1을 만들고 str2는 str1을 변이시켜 만든다.
+// 열 : 알파벳, 길이, 변이율, 커널, 상태, 거리, 반복 수, 한 번의 시간 (초), 초당 계산한 백만 칸, 초당 백만 칸 (n * m 기준), 커널의 메모리 (KB), 지금까지의 최대 RSS (KB)
+// 최대 RSS는 프로세스 전체의 최고치라서 줄어들지 않으므로 줄마다의 메모리는 커널의 메모리 열로 본다.
+// 계산할 칸이 BENCH_MAX_CELLS보다 많거나 (연산자 행렬은 BENCH_MAX_MATRIX 바이트보다 크거나) 비용 모델에 맞지 않는 커널은
+// 건너뛰고 상태 열에 이유(skip:max_cells, skip:max_matrix, skip:cost_model)를 적은 줄만 출력한다. 잰 줄의 상태는 ok
+// return value : 모든 커널의 거리가 같으면 1, 다르거나 메모리가 부족하면 0
+int run_benchmark( FILE *outfp, const long *lengths, int num_lengths, const COST_MODEL *cost);
 
 ////////////////////////////////////////////////////////////////////////////////
 // 세 정수 중에서 가장 작은 값을 리턴한다.
@@ -61,122 +235,606 @@ static int __GetMin4( int a, int b, int c, int d)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// 정렬된 문자쌍들을 출력
-void print_alignment( char align_str[][8], int level)
+// 비용 모델을 돌려준다. (NULL이면 기본 비용)
+static const COST_MODEL _default_cost = { INSERT_COST, DELETE_COST, SUBSTITUTE_COST, TRANSPOSE_COST, NULL };
+
+static inline const COST_MODEL *_cost_model( const COST_MODEL *cost)
 {
-   int i;
+   return (cost != NULL) ? cost : &_default_cost;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 모든 비용이 1인지 (전위 연산이 없어도 됨), 비트 병렬 커널을 쓸 수 있는 경우
+static inline int _cost_is_unit( const COST_MODEL *cost)
+{
+   return cost->ins == 1 && cost->del == 1 && cost->sub == 1 && (cost->trans == 1 || cost->trans < 0) && cost->matrix == NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// str1의 문자 a를 str2의 문자 b로 바꾸는 (같으면 일치) 비용
+static inline int _sub_cost( const COST_MODEL *cost, char a, char b)
+{
+   if (cost->matrix != NULL)
+      return cost->matrix[(unsigned char)a * 256 + (unsigned char)b];
+   return (a == b) ? 0 : cost->sub;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 스레드마다 하나씩 두는 DP 작업 공간 (지금까지 요청된 가장 큰 크기로만 늘어나므로 쌍마다 할당하지 않음)
+// 각 커널은 필요한 메모리를 한 번에 받아 나눠 쓰며, 다른 커널을 부르는 동안에는 쓰지 않는다.
+static __thread void *_workspace = NULL;
+static __thread size_t _workspace_size = 0;
+
+// return value : bytes 이상의 작업 공간, 메모리가 부족하면 NULL
+static void *dp_workspace( size_t bytes)
+{
+   if (bytes > _workspace_size)
+   {
+      size_t size = _workspace_size ? _workspace_size : 4096;
+      while (size < bytes)
+         size *= 2;
+      free( _workspace);
+      _workspace = malloc( size);
+      _workspace_size = (_workspace != NULL) ? size : 0;
+   }
+   return _workspace;
+}
+
+static void dp_workspace_free( void)
+{
+   free( _workspace);
+   _workspace = NULL;
+   _workspace_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 큰 블록 단위로 읽어 그 안에서 줄을 잘라 주는 입력 버퍼
+// 돌려주는 줄은 버퍼 안을 가리키며 (복사하지 않음) 다음 줄을 읽을 때까지 유효하다.
+typedef struct {
+   FILE *fp;
+   char *buf;
+   size_t capacity;            // buf의 크기 (끝의 '\0' 한 칸 제외)
+   size_t start, end;          // 아직 돌려주지 않은 데이터 [start, end)
+   int eof;
+   int error;                  // 메모리 부족
+} LINE_READER;
+
+// return value : 성공 0, 메모리가 부족하면 -1
+static int reader_init( LINE_READER *in, FILE *fp)
+{
+   memset( in, 0, sizeof( LINE_READER));
+   in->fp = fp;
+   in->buf = (char *)malloc( READ_BLOCK_SIZE + 1);
+   if (in->buf == NULL)
+      return -1;
+   in->capacity = READ_BLOCK_SIZE;
+   return 0;
+}
+
+static void reader_free( LINE_READER *in)
+{
+   free( in->buf);
+   in->buf = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 한 줄을 읽는다. (길이 제한 없음, 줄 끝의 '\n', '\r'은 지움)
+// 블록 안에 줄 끝이 없으면 남은 조각만 버퍼 앞으로 옮기고 다음 블록을 읽으며, 한 줄이 버퍼보다 길면 버퍼를 두 배로 늘린다.
+// return value : 줄, 입력 끝이거나 메모리가 부족하면 NULL
+static char *reader_line( LINE_READER *in)
+{
+   size_t scanned = in->start;
    
-   for (i = level; i >= 0; i--)
+   while (1)
    {
-      printf( "%s\n", align_str[i]);
+      char *line = in->buf + in->start;
+      char *nl = (char *)memchr( in->buf + scanned, '\n', in->end - scanned);
+      size_t len;
+      
+      if (nl != NULL)
+      {
+         *nl = '\0';
+         len = nl - line;
+         in->start = nl - in->buf + 1;
+      }
+      else if (in->eof)
+      {
+         if (in->start == in->end)
+            return NULL;
+         in->buf[in->end] = '\0';
+         len = in->end - in->start;
+         in->start = in->end;
+      }
+      else
+      {
+         if (in->start > 0)
+         {
+            memmove( in->buf, line, in->end - in->start);
+            in->end -= in->start;
+            in->start = 0;
+         }
+         if (in->end == in->capacity)
+         {
+            char *buf = (char *)realloc( in->buf, 2 * in->capacity + 1);
+            if (buf == NULL)
+            {
+               in->error = 1;
+               return NULL;
+            }
+            in->buf = buf;
+            in->capacity *= 2;
+         }
+         scanned = in->end;
+         size_t got = fread( in->buf + in->end, 1, in->capacity - in->end, in->fp);
+         if (got == 0)
+            in->eof = 1;
+         in->end += got;
+         continue;
+      }
+      
+      if (len > 0 && line[len - 1] == '\r')
+         line[--len] = '\0';
+      return line;
    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// backtrace_main을 호출하는 wrapper 함수
-// str1 : 문자열 1
-// str2 : 문자열 2
-// n : 문자열 1의 길이
-// m : 문자열 2의 길이
-void backtrace( int *op_matrix, int col_size, char *str1, char *str2, int n, int m)
+// "문자열1\t문자열2" 한 줄을 읽는다. (탭이 없으면 문자열2는 빈 문자열)
+// str1, str2 : 입력 버퍼 안을 가리킴 (다음 줄을 읽을 때까지 유효)
+// return value : 성공 1, 입력 끝 0
+static int read_pair( LINE_READER *in, char **str1, char **str2)
 {
-   char align_str[n+m][8]; // n+m strings
+   char *line = reader_line( in);
    
-   backtrace_main( op_matrix, col_size, str1, str2, n, m, 0, align_str);
+   if (line == NULL)
+      return 0;
    
+   char *tab = strchr( line, '\t');
+   *str1 = line;
+   *str2 = "";
+   if (tab != NULL)
+   {
+      *tab = '\0';
+      *str2 = tab + 1;
+   }
+   return 1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-int main()
+int main( int argc, char **argv)
 {
-   char str1[30];
-   char str2[30];
+   LINE_READER in;
+   char *str1, *str2;
+   char *ops = NULL;
+   size_t ops_capacity = 0;
+   int distance = 0;
+   COST_MODEL cost = _default_cost;
    
-   int distance;
+   // 비용 모델 : -c ins,del,sub,trans (trans가 -이면 전위 없음), -m 교체 비용 행렬 파일 (-c 뒤에)
+   while (argc >= 3 && (strcmp( argv[1], "-c") == 0 || strcmp( argv[1], "-m") == 0))
+   {
+      if ((argv[1][1] == 'c') ? cost_model_parse( &cost, argv[2]) < 0 : cost_model_load_matrix( &cost, argv[2]) < 0)
+      {
+         fprintf( stderr, "Error : invalid cost model \"%s\"\n", argv[2]);
+         cost_model_free( &cost);
+         return 1;
+      }
+      argc -= 2;
+      argv += 2;
+   }
+   
+   // 여러 스레드로 최소편집거리(와 정렬)를 계산하고 입력 순서대로 출력(-b [-a] [threads])
+   if (argc >= 2 && argc <= 4 && strcmp( argv[1], "-b") == 0)
+   {
+      int align = 0, num_threads = 0, i;
+      
+      for (i = 2; i < argc; i++)
+      {
+         if (strcmp( argv[i], "-a") == 0)
+            align = 1;
+         else
+            num_threads = atoi( argv[i]);
+      }
+      if (num_threads <= 0)
+         num_threads = (int)sysconf( _SC_NPROCESSORS_ONLN);
+      if (num_threads <= 0)
+         num_threads = 1;
+      if (num_threads > MAX_THREADS)
+         num_threads = MAX_THREADS;
+      
+      distance = min_editdistance_batch( num_threads, align, &cost);
+      cost_model_free( &cost);
+      return (distance == 0) ? 0 : 1;
+   }
+   
+   // 임의의 문자열 쌍으로 커널별 벤치마크 (-B [length[K|M]...], 길이를 주지 않으면 10, 100, 1K, 10K, 100K, 1M)
+   if (argc >= 2 && strcmp( argv[1], "-B") == 0)
+   {
+      long lengths[16] = { 10, 100, 1000, 10000, 100000, 1000000};
+      int num_lengths = 6, i;
+      
+      if (argc > 2)
+      {
+         num_lengths = 0;
+         for (i = 2; i < argc && num_lengths < 16; i++)
+         {
+            char *end;
+            long length = strtol( argv[i], &end, 10);
+            
+            if (*end == 'K' || *end == 'k') length *= 1000;
+            else if (*end == 'M' || *end == 'm') length *= 1000000;
+            if (length <= 0 || length > INT_MAX / 4)
+            {
+               fprintf( stderr, "Error : invalid length [%s]\n", argv[i]);
+               cost_model_free( &cost);
+               return 1;
+            }
+            lengths[num_lengths++] = length;
+         }
+      }
+      distance = run_benchmark( stdout, lengths, num_lengths, &cost);
+      cost_model_free( &cost);
+      dp_workspace_free();
+      return distance ? 0 : 1;
+   }
    
-   fprintf( stderr, "INSERT_COST = %d\n", INSERT_COST);
-   fprintf( stderr, "DELETE_COST = %d\n", DELETE_COST);
-   fprintf( stderr, "SUBSTITUTE_COST = %d\n", SUBSTITUTE_COST);
-   fprintf( stderr, "TRANSPOSE_COST = %d\n", TRANSPOSE_COST);
+   if (reader_init( &in, stdin) < 0)
+   {
+      fprintf( stderr, "Error : not enough memory!\n");
+      cost_model_free( &cost);
+      return 1;
+   }
+   
+   // 최소편집거리가 k 이하인 쌍만 거리를 출력하고 나머지는 -1 출력(-k k)
+   if (argc == 3 && strcmp( argv[1], "-k") == 0)
+   {
+      int k = atoi( argv[2]);
+      
+      while (read_pair( &in, &str1, &str2))
+      {
+         distance = min_editdistance_bounded( str1, str2, &cost, k);
+         if (distance < 0)
+            break;
+         printf( "%d\n", (distance <= k) ? distance : -1);
+      }
+   }
+   
+   // 사전 파일의 단어 중 stdin의 질의마다 최소편집거리가 k 이하인 (가장 가까운 n개) 단어를 출력(-t dict k [n])
+   // 한 줄에 "질의\t단어\t거리"
+   else if ((argc == 4 || argc == 5) && strcmp( argv[1], "-t") == 0)
+   {
+      int k = atoi( argv[3]);
+      int topk = (argc == 5) ? atoi( argv[4]) : 0;
+      LINE_READER dict;
+      TRIE_MATCH *matches;
+      char *word;
+      int i;
+      
+      FILE *fp = fopen( argv[2], "rt");
+      if (fp == NULL)
+      {
+         fprintf( stderr, "Error : cannot find file \"%s\"\n", argv[2]);
+         reader_free( &in);
+         cost_model_free( &cost);
+         return 1;
+      }
+      TRIE *trie = trie_create();
+      if (trie != NULL && reader_init( &dict, fp) < 0)
+      {
+         trie_destroy( trie);
+         trie = NULL;
+      }
+      if (trie != NULL)
+      {
+         while (trie != NULL && (word = reader_line( &dict)) != NULL)
+         {
+            if (word[0] != '\0' && trie_insert( trie, word) < 0)
+            {
+               trie_destroy( trie);
+               trie = NULL;
+            }
+         }
+         if (dict.error)
+         {
+            trie_destroy( trie);
+            trie = NULL;
+         }
+         reader_free( &dict);
+      }
+      fclose( fp);
+      
+      while (trie != NULL && read_pair( &in, &str1, &str2))
+      {
+         int num = trie_search( trie, str1, &cost, k, topk, &matches);
+         if (num < 0)
+            break;
+         for (i = 0; i < num; i++)
+            printf( "%s\t%s\t%d\n", str1, matches[i].word, matches[i].distance);
+         free( matches);
+      }
+      if (trie == NULL || !in.eof)
+         distance = -1;
+      trie_destroy( trie);
+   }
    
-   while( fscanf( stdin, "%s\t%s", str1, str2) != EOF)
+   // 최소편집거리만 출력(-d, 비용 모델에 맞는 커널, 반대각선 커널은 -s) 또는 선형 메모리로 구한 최적 정렬 하나와 함께 출력(-a)
+   // 한 줄에 "문자열1\t문자열2", 길이 제한 없음
+   else if (argc == 2 && (strcmp( argv[1], "-d") == 0 || strcmp( argv[1], "-a") == 0 || strcmp( argv[1], "-s") == 0))
    {
-      printf( "\n==============================\n");
-      printf( "%s vs. %s\n", str1, str2);
-      printf( "==============================\n");
+      int align = (argv[1][1] == 'a');
+      int simd = (argv[1][1] == 's');
       
-      distance = min_editdistance( str1, str2);
+      while (read_pair( &in, &str1, &str2))
+      {
+         if (align)
+         {
+            // 정렬 버퍼도 가장 긴 쌍의 크기로만 늘림
+            size_t len = strlen( str1) + strlen( str2) + 1;
+            if (len > ops_capacity)
+            {
+               free( ops);
+               ops = (char *)malloc( 2 * len);
+               ops_capacity = (ops != NULL) ? 2 * len : 0;
+            }
+            distance = (ops != NULL) ? min_editdistance_align( str1, str2, &cost, ops) : -1;
+         }
+         else if (simd)
+            distance = min_editdistance_simd( str1, str2, &cost);
+         else
+            distance = min_editdistance_dispatch( str1, str2, &cost);
+         
+         if (distance < 0)
+            break;
+         
+         if (align)
+         {
+            printf( "\n==============================\n");
+            print_ops( str1, str2, ops);
+            printf( "\nMinEdit(%s, %s) = %d\n", str1, str2, distance);
+         }
+         else
+            printf( "%d\n", distance);
+      }
+   }
+   
+   else
+   {
+      fprintf( stderr, "INSERT_COST = %d\n", cost.ins);
+      fprintf( stderr, "DELETE_COST = %d\n", cost.del);
+      fprintf( stderr, "SUBSTITUTE_COST = %d%s\n", cost.sub, (cost.matrix != NULL) ? " (matrix)" : "");
+      fprintf( stderr, "TRANSPOSE_COST = %d\n", cost.trans);
       
-      printf( "\nMinEdit(%s, %s) = %d\n", str1, str2, distance);
+      while (read_pair( &in, &str1, &str2))
+      {
+         printf( "\n==============================\n");
+         printf( "%s vs. %s\n", str1, str2);
+         printf( "==============================\n");
+         
+         distance = min_editdistance( str1, str2, &cost);
+         if (distance < 0)
+            break;
+         
+         printf( "\nMinEdit(%s, %s) = %d\n", str1, str2, distance);
+      }
+   }
+   
+   if (distance < 0 || in.error)
+      fprintf( stderr, "Error : not enough memory!\n");
+   free( ops);
+   reader_free( &in);
+   cost_model_free( &cost);
+   dp_workspace_free();
+   return (distance < 0 || in.error) ? 1 : 0;
+}
+
+// 연산자 행렬을 만든다. (d는 세 행만 유지)
+unsigned char* min_editdistance_matrix(char* str1, char* str2, const COST_MODEL* cost, int* distance) {
+   int n = strlen(str1);
+   int m = strlen(str2);
+   int col_size = m + 1;
+   int i, j;
+
+   cost = _cost_model(cost);
+
+   unsigned char* op_matrix = (unsigned char*)calloc((size_t)(n + 1) * col_size, 1);
+   int* rows = (int*)dp_workspace(sizeof(int) * 3 * col_size);
+   if (op_matrix == NULL || rows == NULL) {
+      free(op_matrix);
+      return NULL;
+   }
+   // prev2 : d[i-2][], prev : d[i-1][], cur : d[i][]
+   int* prev2 = rows;
+   int* prev = rows + col_size;
+   int* cur = rows + 2 * col_size;
+
+   for (j = 0; j < m + 1; ++j)
+      prev[j] = j * cost->ins;
+   for (j = 1; j < m + 1; ++j)
+      op_matrix[j] = INSERT_OP;
+
+   for (i = 1; i < n + 1; ++i) {
+      unsigned char* op = op_matrix + (size_t)i * col_size;
+      char a = str1[i - 1];
+
+      cur[0] = i * cost->del;
+      op[0] = DELETE_OP;
+      for (j = 1; j < m + 1; ++j) {
+         char b = str2[j - 1];
+         int diag = prev[j - 1] + _sub_cost(cost, a, b);
+         int v = __GetMin3(cur[j - 1] + cost->ins, prev[j] + cost->del, diag);
+         int swap = (cost->trans >= 0 && i > 1 && j > 1 && a == str2[j - 2] && str1[i - 2] == b);
+
+         if (swap && prev2[j - 2] + cost->trans < v)
+            v = prev2[j - 2] + cost->trans;
+         cur[j] = v;
+
+         unsigned char flags = 0;
+         if (v == prev[j] + cost->del)
+            flags |= DELETE_OP;
+         if (v == cur[j - 1] + cost->ins)
+            flags |= INSERT_OP;
+         if (v == diag)
+            flags |= (a == b) ? MATCH_OP : SUBSTITUTE_OP;
+         if (swap && v == prev2[j - 2] + cost->trans)
+            flags |= TRANSPOSE_OP;
+         op[j] = flags;
+      }
+
+      int* tmp = prev2; prev2 = prev; prev = cur; cur = tmp;
    }
+
+   *distance = prev[m];
+   return op_matrix;
+}
+
+// 최적 정렬 반복자를 준비한다.
+int align_iter_init(ALIGN_ITER* it, const unsigned char* op_matrix, int col_size, int n, int m, long long limit) {
+   it->op_matrix = op_matrix;
+   it->col_size = col_size;
+   it->count = 0;
+   it->limit = limit;
+   it->stack = (ALIGN_FRAME*)malloc(sizeof(ALIGN_FRAME) * (n + m + 1));
+   if (it->stack == NULL)
+      return -1;
+   it->depth = 1;
+   it->stack[0].i = n;
+   it->stack[0].j = m;
+   it->stack[0].rest = op_matrix[(size_t)n * col_size + m];
    return 0;
 }
 
-// 재귀적으로 연산자 행렬을 순회하며, 두 문자열이 최소편집거리를 갖는 모든 가능한 정렬(alignment) 결과를 출력한다.
-// op_matrix : 이전 상태의 연산자 정보가 저장된 행렬 (1차원 배열임에 주의!)
-// col_size : op_matrix의 열의 크기
-// str1 : 문자열 1
-// str2 : 문자열 2
-// n : 문자열 1의 길이
-// m : 문자열 2의 길이
-// level : 재귀호출의 레벨 (0, 1, 2, ...)
-// align_str : 정렬된 문자쌍들의 정보가 저장된 문자열 배열 예) "a - a", "a - b", "* - b", "ab - ba"
-static void backtrace_main(int* op_matrix, int col_size, char* str1, char* str2, int n, int m, int level, char align_str[][8]) {
-    static int cnt = 1;
-   if (n == 0 && m == 0) {
-      printf("\n[%d] ==============================\n", cnt++);
-      print_alignment(align_str, level-1);
+// 스택 맨 위의 칸에서 아직 따라가 보지 않은 연산을 하나 골라 다음 칸을 쌓는다.
+// (0, 0)에 도착하면 경로를 ops에 앞에서부터 적는다.
+int align_iter_next(ALIGN_ITER* it, char* ops) {
+   if (it->limit > 0 && it->count >= it->limit)
+      return 0;
+
+   // 앞에서 돌려준 경로가 있으면 그 끝 (0, 0)부터 되돌아감
+   if (it->count > 0)
+      it->depth--;
+
+   while (it->depth > 0) {
+      ALIGN_FRAME* f = &it->stack[it->depth - 1];
+      int i = f->i, j = f->j;
+
+      if (i == 0 && j == 0) {
+         int k, len = 0;
+         for (k = it->depth - 2; k >= 0; --k)
+            ops[len++] = it->stack[k].op;
+         ops[len] = '\0';
+         it->count++;
+         return 1;
+      }
+      if (f->rest == 0) {
+         it->depth--;
+         continue;
+      }
+
+      if (f->rest & (MATCH_OP | SUBSTITUTE_OP)) {
+         f->op = (f->rest & MATCH_OP) ? 'M' : 'S';
+         f->rest &= ~(MATCH_OP | SUBSTITUTE_OP);
+         i--; j--;
+      }
+      else if (f->rest & INSERT_OP) {
+         f->op = 'I';
+         f->rest &= ~INSERT_OP;
+         j--;
+      }
+      else if (f->rest & DELETE_OP) {
+         f->op = 'D';
+         f->rest &= ~DELETE_OP;
+         i--;
+      }
+      else {
+         f->op = 'T';
+         f->rest &= ~TRANSPOSE_OP;
+         i -= 2; j -= 2;
+      }
+
+      ALIGN_FRAME* next = &it->stack[it->depth++];
+      next->i = i;
+      next->j = j;
+      next->rest = it->op_matrix[(size_t)i * it->col_size + j];
+   }
+   return 0;
+}
+
+void align_iter_free(ALIGN_ITER* it) {
+   free(it->stack);
+   it->stack = NULL;
+}
+
+// 경로의 수 c에 x를 더한다. (cap에서 멈추므로 넘치지 않음, c와 x는 cap 이하)
+static inline long long _count_add(long long c, long long x, long long cap) {
+   return (x > cap - c) ? cap : c + x;
+}
+
+// 최적 정렬의 수를 센다. cnt[i][j] = (0, 0)에서 (i, j)까지 연산자를 따라가는 경로의 수
+long long align_count(const unsigned char* op_matrix, int col_size, int n, int m, long long cap) {
+   int i, j;
+
+   if (cap <= 0)
+      cap = LLONG_MAX;
+   long long* rows = (long long*)dp_workspace(sizeof(long long) * 3 * (m + 1));
+   if (rows == NULL)
+      return -1;
+   long long* prev2 = rows;
+   long long* prev = rows + (m + 1);
+   long long* cur = rows + 2 * (m + 1);
+
+   for (i = 0; i < n + 1; ++i) {
+      const unsigned char* op = op_matrix + (size_t)i * col_size;
+
+      for (j = 0; j < m + 1; ++j) {
+         long long c = 0;
+
+         if (i == 0 && j == 0)
+            c = 1;
+         if (op[j] & (MATCH_OP | SUBSTITUTE_OP))
+            c = _count_add(c, prev[j - 1], cap);
+         if (op[j] & INSERT_OP)
+            c = _count_add(c, cur[j - 1], cap);
+         if (op[j] & DELETE_OP)
+            c = _count_add(c, prev[j], cap);
+         if (op[j] & TRANSPOSE_OP)
+            c = _count_add(c, prev2[j - 2], cap);
+         cur[j] = c;
+      }
+
+      long long* tmp = prev2; prev2 = prev; prev = cur; cur = tmp;
+   }
+
+   return prev[m];
+}
+
+// 최적 정렬을 최대 MAX_ALIGNMENTS개까지 출력한다.
+void backtrace(const unsigned char* op_matrix, int col_size, char* str1, char* str2, int n, int m) {
+   ALIGN_ITER it;
+   char* ops = (char*)malloc(n + m + 1);
+
+   if (ops == NULL || align_iter_init(&it, op_matrix, col_size, n, m, MAX_ALIGNMENTS) < 0) {
+      fprintf(stderr, "Error : not enough memory!\n");
+      free(ops);
       return;
    }
-   int op = op_matrix[n * col_size + m];
-   if (op & 4 || op & 8) { // 교체 또는 일치
-      align_str[level][0] = str1[n];
-      align_str[level][1] = ' ';
-      align_str[level][2] = '-';
-      align_str[level][3] = ' ';
-      align_str[level][4] = str2[m];
-      align_str[level][5] = '\0';
-      backtrace_main(op_matrix, col_size, str1, str2, n - 1, m - 1, level+1, align_str);
-   }
-   if (op & 1) { // 삽입
-      align_str[level][0] = '*';
-      align_str[level][1] = ' ';
-      align_str[level][2] = '-';
-      align_str[level][3] = ' ';
-      align_str[level][4] = str2[m];
-      align_str[level][5] = '\0';
-      backtrace_main(op_matrix, col_size, str1, str2, n, m - 1, level+1, align_str);
-   }
-   if (op & 2) { // 삭제
-      align_str[level][0] = str1[n];
-      align_str[level][1] = ' ';
-      align_str[level][2] = '-';
-      align_str[level][3] = ' ';
-      align_str[level][4] = '*';
-      align_str[level][5] = '\0';
-      backtrace_main(op_matrix, col_size, str1, str2, n - 1, m, level+1, align_str);
-   }
-   if (op & 16) { // 전위
-      align_str[level][0] = str1[n - 1];
-      align_str[level][1] = str1[n];
-      align_str[level][2] = ' ';
-      align_str[level][3] = '-';
-      align_str[level][4] = ' ';
-      align_str[level][5] = str2[m - 1];
-      align_str[level][6] = str2[m];
-      align_str[level][7] = '\0';
-      backtrace_main(op_matrix, col_size, str1, str2, n - 2, m - 2, level+1, align_str);
-   }
-   if (level == 0)
-       cnt = 1;
+   while (align_iter_next(&it, ops)) {
+      printf("\n[%lld] ==============================\n", it.count);
+      print_ops(str1, str2, ops);
+   }
+   align_iter_free(&it);
+   free(ops);
+
+   long long total = align_count(op_matrix, col_size, n, m, 0);
+   if (total > MAX_ALIGNMENTS)
+      printf("\n... %lld%s optimal alignments, first %d shown\n", total, (total == LLONG_MAX) ? "+" : "", MAX_ALIGNMENTS);
 }
 
 // 강의 자료의 형식대로 op_matrix를 출력 (좌하단(1,1) -> 우상단(n, m))
 // 각 연산자를 다음과 같은 기호로 표시한다. 삽입:I, 삭제:D, 교체:S, 일치:M, 전위:T
-void print_matrix(int* op_matrix, int col_size, char* str1, char* str2, int n, int m) {
+void print_matrix(const unsigned char* op_matrix, int col_size, char* str1, char* str2, int n, int m) {
    int i, j;
    for (i = n; i > 0; --i) {
-      fprintf(stdout, "%c\t", str1[i]);
+      fprintf(stdout, "%c\t", str1[i - 1]);
       for (j = 1; j < m + 1; ++j) {
          if (op_matrix[i * col_size + j] & 16) fprintf(stdout, "T");
          if (op_matrix[i * col_size + j] & 8) fprintf(stdout, "M");
@@ -189,83 +847,1548 @@ void print_matrix(int* op_matrix, int col_size, char* str1, char* str2, int n, i
    }
    fprintf(stdout, "\t");
    for (j = 1; j < m + 1; ++j)
-      fprintf(stdout, "%c\t", str2[j]);
+      fprintf(stdout, "%c\t", str2[j - 1]);
    fprintf(stdout, "\n");
 }
 
 // 두 문자열 str1과 str2의 최소편집거리를 계산한다. 
 // return value : 최소편집거리
 // 이 함수 내부에서 print_matrix 함수와 backtrace 함수를 호출함
-int min_editdistance(char* str1, char* str2) {
+int min_editdistance(char* str1, char* str2, const COST_MODEL* cost) {
    int n = strlen(str1);
    int m = strlen(str2);
+   int distance;
+
+   unsigned char* op_matrix = min_editdistance_matrix(str1, str2, cost, &distance);
+   if (op_matrix == NULL)
+      return -1;
+
+   print_matrix(op_matrix, m + 1, str1, str2, n, m);
+   backtrace(op_matrix, m + 1, str1, str2, n, m);
+
+   free(op_matrix);
+   return distance;
+}
+
+// min_editdistance_linear의 루프 (세 행만 유지)
+// use_matrix, use_trans는 상수로만 넘겨서 교체 비용 행렬과 전위 연산의 유무마다 따로 컴파일되게 한다.
+// rows : 3 * (m + 1)개의 작업 공간
+static inline __attribute__((always_inline)) int _linear_kernel(const char* str1, int n, const char* str2, int m,
+   int ins, int del, const COST_MODEL* cost, int* rows, const int use_matrix, const int use_trans) {
+   int sub = cost->sub, trans = cost->trans;
    int i, j;
-   int d[n + 1][m + 1];
-   int op_matrix[(n + 1) * (m + 1)];
-   int col_size = n + 1;
 
-   char newstr1[31] = { '#', }, newstr2[31] = { '#', };
-   for (i = 0; i < n; ++i) {
-      newstr1[i + 1] = str1[i];
+   // prev2 : d[i-2][], prev : d[i-1][], cur : d[i][]
+   int* prev2 = rows;
+   int* prev = rows + (m + 1);
+   int* cur = rows + 2 * (m + 1);
+
+   for (j = 0; j < m + 1; ++j)
+      prev[j] = j * ins;
+
+   for (i = 1; i < n + 1; ++i) {
+      char a = str1[i - 1];
+      const int* sub_row = use_matrix ? cost->matrix + (unsigned char)a * 256 : NULL;
+
+      cur[0] = i * del;
+      for (j = 1; j < m + 1; ++j) {
+         char b = str2[j - 1];
+         int c = use_matrix ? sub_row[(unsigned char)b] : ((a == b) ? 0 : sub);
+         int v = __GetMin3(cur[j - 1] + ins, prev[j] + del, prev[j - 1] + c);
+
+         if (use_trans && i > 1 && j > 1 && a == str2[j - 2] && str1[i - 2] == b && prev2[j - 2] + trans < v)
+            v = prev2[j - 2] + trans;
+         cur[j] = v;
+      }
+
+      int* tmp = prev2; prev2 = prev; prev = cur; cur = tmp;
    }
-   for (j = 0; j < m; ++j) {
-      newstr2[j + 1] = str2[j];
+
+   return prev[m];
+}
+
+// 두 문자열 str1과 str2의 최소편집거리만 계산한다. (세 행만 유지)
+// 열이 짧은 쪽이 되도록 두 문자열을 바꾸면 삽입과 삭제의 역할도 바뀌므로 비용을 함께 바꾼다.
+int min_editdistance_linear(char* str1, char* str2, const COST_MODEL* cost) {
+   int n = strlen(str1);
+   int m = strlen(str2);
+   int ins, del;
+
+   cost = _cost_model(cost);
+   ins = cost->ins; del = cost->del;
+
+   // 교체 비용 행렬은 str1, str2의 순서가 정해져 있으므로 행렬이 없을 때만 바꿈
+   if (m > n && cost->matrix == NULL) {
+      char* tmp = str1; str1 = str2; str2 = tmp;
+      int t = n; n = m; m = t;
+      ins = cost->del; del = cost->ins;
    }
-   
-   for (i = 0; i < n + 1; ++i)
-      d[i][0] = i;
+
+   int* rows = (int*)dp_workspace(sizeof(int) * 3 * (m + 1));
+   if (rows == NULL)
+      return -1;
+
+   // 상수 인자로 부르므로 루프가 경우마다 따로 펼쳐짐
+   if (cost->matrix == NULL)
+      return (cost->trans >= 0) ? _linear_kernel(str1, n, str2, m, ins, del, cost, rows, 0, 1)
+                                : _linear_kernel(str1, n, str2, m, ins, del, cost, rows, 0, 0);
+   return (cost->trans >= 0) ? _linear_kernel(str1, n, str2, m, ins, del, cost, rows, 1, 1)
+                             : _linear_kernel(str1, n, str2, m, ins, del, cost, rows, 1, 0);
+}
+
+// 부분 문제 a[0..n)과 b[0..m)의 마지막 두 행 d[n-1][], d[n][]을 계산한다. (세 행만 유지)
+// rows : 3 * (m + 1)개의 작업 공간
+// last : d[n][]의 위치, before : d[n-1][]의 위치 (n이 0이면 NULL)
+static void _last_rows(const char* a, int n, const char* b, int m, const COST_MODEL* cost, int* rows, int** last, int** before) {
+   int* prev2 = rows;
+   int* prev = rows + (m + 1);
+   int* cur = rows + 2 * (m + 1);
+   int i, j;
+
    for (j = 0; j < m + 1; ++j)
-      d[0][j] = j;
+      prev[j] = j * cost->ins;
+   *before = NULL;
+
    for (i = 1; i < n + 1; ++i) {
-      for (int j = 1; j < m + 1; ++j) {
-         if (newstr1[i] == newstr2[j])
-            d[i][j] = __GetMin3(d[i][j - 1] + INSERT_COST, d[i - 1][j] + DELETE_COST, d[i - 1][j - 1]);
-         else
-            d[i][j] = __GetMin3(d[i][j - 1] + INSERT_COST, d[i - 1][j] + DELETE_COST, d[i - 1][j - 1] + SUBSTITUTE_COST);
+      char x = a[i - 1];
+
+      cur[0] = i * cost->del;
+      for (j = 1; j < m + 1; ++j) {
+         char y = b[j - 1];
+         int v = __GetMin3(cur[j - 1] + cost->ins, prev[j] + cost->del, prev[j - 1] + _sub_cost(cost, x, y));
 
-         if (i > 1 && j > 1 && newstr1[i] == newstr2[j - 1] && newstr1[i - 1] == newstr2[j])
-            d[i][j] = (d[i][j] < d[i - 2][j - 2] + TRANSPOSE_COST) ? d[i][j] : d[i - 2][j - 2] + TRANSPOSE_COST;
+         if (cost->trans >= 0 && i > 1 && j > 1 && x == b[j - 2] && a[i - 2] == y && prev2[j - 2] + cost->trans < v)
+            v = prev2[j - 2] + cost->trans;
+         cur[j] = v;
       }
+
+      int* tmp = prev2; prev2 = prev; prev = cur; cur = tmp;
+      *before = prev2;
    }
+   *last = prev;
+}
+
+// 작은 부분 문제 (n <= 2)는 전체 행렬을 채운 뒤 역추적하여 ops에 연산을 저장한다.
+// table : (n + 1) * (m + 1)개의 작업 공간
+// return value : 저장한 연산의 수
+static int _align_small(const char* a, int n, const char* b, int m, const COST_MODEL* cost, int* table, char* ops) {
+   int col_size = m + 1;
+   int i, j, k = 0;
 
    for (i = 0; i < n + 1; ++i) {
       for (j = 0; j < m + 1; ++j) {
-         op_matrix[i * col_size + j] = 0;
+         int v;
+         if (i == 0)
+            v = j * cost->ins;
+         else if (j == 0)
+            v = i * cost->del;
+         else {
+            v = __GetMin3(table[i * col_size + j - 1] + cost->ins, table[(i - 1) * col_size + j] + cost->del,
+               table[(i - 1) * col_size + j - 1] + _sub_cost(cost, a[i - 1], b[j - 1]));
+            if (cost->trans >= 0 && i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] && table[(i - 2) * col_size + j - 2] + cost->trans < v)
+               v = table[(i - 2) * col_size + j - 2] + cost->trans;
+         }
+         table[i * col_size + j] = v;
       }
    }
 
-   for (i = 1; i < n + 1; ++i)
-      op_matrix[i * col_size] += DELETE_OP;
-   for (j = 1; j < n + 1; ++j)
-      op_matrix[j] += INSERT_OP;
+   // 끝에서부터 역추적하여 거꾸로 저장한 뒤 뒤집음 (backtrace_main과 같이 교체/일치, 삽입, 삭제, 전위 순으로 선택)
+   i = n; j = m;
+   while (i > 0 || j > 0) {
+      int v = table[i * col_size + j];
 
-   for (i = 1; i < n + 1; ++i) {
-      for (j = 1; j < m + 1; ++j) {
-         if (newstr1[i] == newstr2[j]) {
-            if (d[i][j] == d[i - 1][j] + DELETE_COST)
-               op_matrix[i * col_size + j] |= DELETE_OP;
-            if (d[i][j] == d[i][j - 1] + INSERT_COST)
-               op_matrix[i * col_size + j] |= INSERT_OP;
-            if (d[i][j] == d[i - 1][j - 1])
-               op_matrix[i * col_size + j] |= MATCH_OP;
-         }
-         else {
-            if (d[i][j] == d[i - 1][j] + DELETE_COST)
-               op_matrix[i * col_size + j] |= DELETE_OP;
-            if (d[i][j] == d[i][j - 1] + INSERT_COST)
-               op_matrix[i * col_size + j] |= INSERT_OP;
-            if (d[i][j] == d[i - 1][j - 1] + SUBSTITUTE_COST)
-               op_matrix[i * col_size + j] |= SUBSTITUTE_OP;
-         }
-         if (i > 1 && j > 1 && newstr1[i] == newstr2[j - 1] && newstr1[i - 1] == newstr2[j]) {
-            if (d[i][j] == d[i - 2][j - 2] + TRANSPOSE_COST)
-               op_matrix[i * col_size + j] |= TRANSPOSE_OP;
+      if (i > 0 && j > 0 && v == table[(i - 1) * col_size + j - 1] + _sub_cost(cost, a[i - 1], b[j - 1])) {
+         ops[k++] = (a[i - 1] == b[j - 1]) ? 'M' : 'S';
+         i--; j--;
+      }
+      else if (j > 0 && v == table[i * col_size + j - 1] + cost->ins) {
+         ops[k++] = 'I';
+         j--;
+      }
+      else if (i > 0 && v == table[(i - 1) * col_size + j] + cost->del) {
+         ops[k++] = 'D';
+         i--;
+      }
+      else {
+         ops[k++] = 'T';
+         i -= 2; j -= 2;
+      }
+   }
+
+   for (i = 0; i < k / 2; ++i) {
+      char tmp = ops[i];
+      ops[i] = ops[k - 1 - i];
+      ops[k - 1 - i] = tmp;
+   }
+   return k;
+}
+
+// Hirschberg 분할 정복
+// a[0..n)과 b[0..m)의 최적 정렬을 ops에 저장한다. ra, rb : 원래 문자열 전체를 뒤집은 문자열
+// ra_end, rb_end : 부분 문제를 뒤집은 문자열의 끝 (a가 str1 + x이면 ra_end는 ra + strlen(str1) - x)
+// fwd, bwd : 각각 3 * (m + 1)개의 작업 공간
+// return value : 저장한 연산의 수
+static int _hirschberg(const char* a, int n, const char* b, int m, const char* ra_end, const char* rb_end,
+   const COST_MODEL* cost, int* fwd, int* bwd, char* ops) {
+   int i, j, k = 0;
+
+   if (n == 0) {
+      for (j = 0; j < m; ++j)
+         ops[k++] = 'I';
+      return k;
+   }
+   if (m == 0) {
+      for (i = 0; i < n; ++i)
+         ops[k++] = 'D';
+      return k;
+   }
+   if (n <= 2)
+      return _align_small(a, n, b, m, cost, fwd, ops);
+
+   int mid = n / 2;
+   int *f_last, *f_before, *r_last, *r_before;
+
+   // 앞쪽 절반의 마지막 두 행 : F[mid][], F[mid-1][]
+   _last_rows(a, mid, b, m, cost, fwd, &f_last, &f_before);
+   // 뒤쪽 절반을 뒤집어 계산 : B[mid][j] = r_last[m-j], B[mid+1][j] = r_before[m-j]
+   _last_rows(ra_end - n, n - mid, rb_end - m, m, cost, bwd, &r_last, &r_before);
+
+   // 가운데 행의 (mid, j)를 지나는 경로
+   int best = f_last[0] + r_last[m], best_j = 0, transpose = 0;
+   for (j = 1; j < m + 1; ++j) {
+      if (f_last[j] + r_last[m - j] < best) {
+         best = f_last[j] + r_last[m - j];
+         best_j = j;
+      }
+   }
+   // (mid-1, j-1)에서 (mid+1, j+1)로 가는 전위 연산으로 가운데 행을 건너뛰는 경로
+   for (j = 1; j < m && cost->trans >= 0; ++j) {
+      if (a[mid] == b[j - 1] && a[mid - 1] == b[j]) {
+         int v = f_before[j - 1] + cost->trans + r_before[m - j - 1];
+         if (v < best) {
+            best = v;
+            best_j = j;
+            transpose = 1;
          }
       }
    }
 
-   print_matrix(op_matrix, col_size, newstr1, newstr2, n, m);
-   backtrace(op_matrix, col_size, newstr1, newstr2, n, m);
+   if (!transpose) {
+      k = _hirschberg(a, mid, b, best_j, ra_end, rb_end, cost, fwd, bwd, ops);
+      k += _hirschberg(a + mid, n - mid, b + best_j, m - best_j, ra_end - mid, rb_end - best_j, cost, fwd, bwd, ops + k);
+   }
+   else {
+      k = _hirschberg(a, mid - 1, b, best_j - 1, ra_end, rb_end, cost, fwd, bwd, ops);
+      ops[k++] = 'T';
+      k += _hirschberg(a + mid + 1, n - mid - 1, b + best_j + 1, m - best_j - 1, ra_end - (mid + 1), rb_end - (best_j + 1), cost, fwd, bwd, ops + k);
+   }
+   return k;
+}
+
+// 두 문자열 str1과 str2의 최적 정렬 하나를 선형 메모리로 구한다.
+int min_editdistance_align(char* str1, char* str2, const COST_MODEL* cost, char* ops) {
+   int n = strlen(str1);
+   int m = strlen(str2);
+   int i, j, k, distance = 0;
+
+   cost = _cost_model(cost);
+
+   // 앞/뒤 방향 작업 공간과 뒤집은 문자열 2개
+   int* work = (int*)dp_workspace(sizeof(int) * 6 * (m + 1) + n + m + 2);
+   if (work == NULL)
+      return -1;
+   char* rev = (char*)(work + 6 * (m + 1));
+   char* ra = rev;
+   char* rb = rev + n + 1;
+   for (i = 0; i < n; ++i)
+      ra[i] = str1[n - 1 - i];
+   for (i = 0; i < m; ++i)
+      rb[i] = str2[m - 1 - i];
 
-   return d[n][m];
-}
\ No newline at end of file
+   // 부분 문제 a[x..y)를 뒤집은 문자열은 ra[n-y .. n-x)이므로 그 끝(ra + n - x)을 넘겨줌
+   k = _hirschberg(str1, n, str2, m, ra + n, rb + m, cost, work, work + 3 * (m + 1), ops);
+   ops[k] = '\0';
+
+   // 교체 비용 행렬에서는 일치도 비용이 있을 수 있으므로 문자를 따라가며 더함
+   i = 0; j = 0;
+   for (k = 0; ops[k] != '\0'; ++k) {
+      switch (ops[k]) {
+      case 'M':
+      case 'S': distance += _sub_cost(cost, str1[i++], str2[j++]); break;
+      case 'I': distance += cost->ins; j++; break;
+      case 'D': distance += cost->del; i++; break;
+      case 'T': distance += cost->trans; i += 2; j += 2; break;
+      }
+   }
+
+   return distance;
+}
+
+// min_editdistance_align의 결과를 정렬된 문자쌍 형식으로 출력
+void print_ops(char* str1, char* str2, char* ops) {
+   int i = 0, j = 0, k;
+
+   for (k = 0; ops[k] != '\0'; ++k) {
+      switch (ops[k]) {
+      case 'M':
+      case 'S':
+         printf("%c - %c\n", str1[i++], str2[j++]);
+         break;
+      case 'I':
+         printf("* - %c\n", str2[j++]);
+         break;
+      case 'D':
+         printf("%c - *\n", str1[i++]);
+         break;
+      case 'T':
+         printf("%c%c - %c%c\n", str1[i], str1[i + 1], str2[j], str2[j + 1]);
+         i += 2; j += 2;
+         break;
+      }
+   }
+}
+
+// 패턴의 한 워드에 해당하는 열 상태를 갱신한다. (Hyyrö의 전위 연산 확장)
+// eq : 현재 문자의 일치 비트, prev_eq : 이전 문자의 일치 비트
+// *vp, *vn : 수직 차이 +1/-1, *d0 : 대각 차이 0 (이전 열의 값을 받아 갱신)
+// carry : 아래 워드에서 넘어온 자리올림들 [덧셈, 전위, HP, HN]
+// *hp, *hn : 이 워드의 수평 차이 +1/-1
+static inline void _bitparallel_word(uint64_t eq, uint64_t prev_eq, uint64_t* vp, uint64_t* vn, uint64_t* d0,
+   uint64_t carry[4], uint64_t* hp, uint64_t* hn) {
+   uint64_t x = ~*d0 & eq;
+   uint64_t tr = ((x << 1) | carry[1]) & prev_eq;
+   uint64_t t = eq & *vp;
+   uint64_t sum = t + *vp;
+   uint64_t c = (sum < t);
+   sum += carry[0];
+   c |= (sum < carry[0]);
+
+   carry[0] = c;
+   carry[1] = x >> 63;
+
+   uint64_t d = (sum ^ *vp) | eq | *vn | tr;
+   uint64_t h_p = *vn | ~(d | *vp);
+   uint64_t h_n = *vp & d;
+   uint64_t xp = (h_p << 1) | carry[2];
+   uint64_t xn = (h_n << 1) | carry[3];
+
+   carry[2] = h_p >> 63;
+   carry[3] = h_n >> 63;
+
+   *vn = xp & d;
+   *vp = xn | ~(d | xp);
+   *d0 = d;
+   *hp = h_p;
+   *hn = h_n;
+}
+
+// 모든 비용이 1일 때 비트 병렬로 최소편집거리를 계산한다.
+int min_editdistance_bitparallel(char* str1, char* str2, const COST_MODEL* cost) {
+   int n = strlen(str1);
+   int m = strlen(str2);
+   int i, j, w;
+
+   cost = _cost_model(cost);
+   if (!_cost_is_unit(cost))
+      return min_editdistance_dispatch(str1, str2, cost);
+   int transpose = (cost->trans >= 0);
+
+   // 짧은 쪽을 패턴으로 사용 (비용이 모두 같으므로 대칭)
+   if (m > n) {
+      char* tmp = str1; str1 = str2; str2 = tmp;
+      int t = n; n = m; m = t;
+   }
+   if (m == 0)
+      return n;
+
+   // 패턴에 나오는 문자만 일치 비트 테이블에 행을 가짐 (행 0 : 패턴에 없는 문자)
+   int words = (m + 63) / 64;
+   int row[256] = { 0, };
+   int num_rows = 1;
+   for (i = 0; i < m; ++i)
+      if (row[(unsigned char)str2[i]] == 0)
+         row[(unsigned char)str2[i]] = num_rows++;
+
+   size_t peq_size = ((size_t)num_rows * words + 3 * words) * sizeof(uint64_t);
+   uint64_t* peq = (uint64_t*)dp_workspace(peq_size);
+   if (peq == NULL)
+      return -1;
+   memset(peq, 0, peq_size);
+   uint64_t* vp = peq + (size_t)num_rows * words;
+   uint64_t* vn = vp + words;
+   uint64_t* d0 = vn + words;
+
+   for (i = 0; i < m; ++i)
+      peq[(size_t)row[(unsigned char)str2[i]] * words + i / 64] |= (uint64_t)1 << (i % 64);
+   for (w = 0; w < words; ++w)
+      vp[w] = ~(uint64_t)0; // 첫 열 d[i][0] = i
+
+   int score = m;
+   uint64_t last_bit = (uint64_t)1 << ((m - 1) % 64);
+   const uint64_t* prev_eq = peq; // 첫 문자 앞은 일치하는 문자가 없음
+
+   for (j = 0; j < n; ++j) {
+      const uint64_t* eq = peq + (size_t)row[(unsigned char)str1[j]] * words;
+      uint64_t carry[4] = { 0, 0, 1, 0 }; // 첫 행 d[0][j] = j 이므로 HP에 1을 채움
+      uint64_t hp = 0, hn = 0;
+
+      for (w = 0; w < words; ++w)
+         _bitparallel_word(eq[w], prev_eq[w], &vp[w], &vn[w], &d0[w], carry, &hp, &hn);
+
+      // 마지막 워드의 패턴 마지막 행 비트가 d[m][j]의 변화량
+      if (hp & last_bit)
+         score++;
+      else if (hn & last_bit)
+         score--;
+      if (transpose)
+         prev_eq = eq;
+   }
+
+   return score;
+}
+
+// 두 문자열 str1과 str2의 최소편집거리가 k 이하인지 대각 띠 안에서만 계산하여 판정한다.
+// 행 i의 열 j는 띠 안의 위치 j - i - lo에 저장하므로 d[i-1][j-1]과 d[i-2][j-2]는 같은 위치에 있다.
+int min_editdistance_bounded(char* str1, char* str2, const COST_MODEL* cost, int k) {
+   int n = strlen(str1);
+   int m = strlen(str2);
+   int i, j;
+
+   cost = _cost_model(cost);
+
+   if (k < 0)
+      return k + 1;
+
+   // 대각선 j - i의 범위 : 그보다 멀리 가려면 삽입 또는 삭제만으로 k를 넘음
+   int lo = -(k / cost->del);
+   int hi = k / cost->ins;
+   if (m - n < lo || m - n > hi)
+      return k + 1;
+
+   int width = hi - lo + 1;
+   int inf = INT_MAX / 2; // 띠 밖 (더해도 넘치지 않음)
+   int* rows = (int*)dp_workspace(sizeof(int) * 3 * width);
+   if (rows == NULL)
+      return -1;
+   int* prev2 = rows;
+   int* prev = rows + width;
+   int* cur = rows + 2 * width;
+
+   for (j = 0; j < 3 * width; ++j)
+      rows[j] = inf;
+   for (j = 0; j <= hi && j <= m; ++j)
+      prev[j - lo] = j * cost->ins;
+
+   for (i = 1; i < n + 1; ++i) {
+      int j_lo = (i + lo > 0) ? i + lo : 0;
+      int j_hi = (i + hi < m) ? i + hi : m;
+      int row_min = inf;
+      char a = str1[i - 1];
+
+      for (j = 0; j < width; ++j)
+         cur[j] = inf;
+
+      for (j = j_lo; j <= j_hi; ++j) {
+         int x = j - i - lo; // 띠 안의 위치
+         int v;
+
+         if (j == 0)
+            v = i * cost->del;
+         else {
+            char b = str2[j - 1];
+            v = prev[x] + _sub_cost(cost, a, b);
+            if (x > 0 && cur[x - 1] + cost->ins < v)
+               v = cur[x - 1] + cost->ins;
+            if (x + 1 < width && prev[x + 1] + cost->del < v)
+               v = prev[x + 1] + cost->del;
+            if (cost->trans >= 0 && i > 1 && j > 1 && a == str2[j - 2] && str1[i - 2] == b && prev2[x] + cost->trans < v)
+               v = prev2[x] + cost->trans;
+         }
+         cur[x] = v;
+         if (v < row_min)
+            row_min = v;
+      }
+
+      // 이후의 값은 이 행과 이전 행(전위 연산)의 최소값보다 작아질 수 없음
+      int bound = row_min;
+      for (j = 0; j < width; ++j)
+         if (prev[j] < bound)
+            bound = prev[j];
+      if (bound > k)
+         return k + 1;
+
+      int* tmp = prev2; prev2 = prev; prev = cur; cur = tmp;
+   }
+
+   int distance = prev[m - n - lo];
+   return (distance <= k) ? distance : k + 1;
+}
+
+// 반대각선 커널이 공유하는 값들
+// cur : d[i][j] (i + j = d), d1, d2, d4 : 반대각선 d-1, d-2, d-4 (모두 행 번호 i로 색인)
+// a[i] = str1[i-1], r[k] = str2를 뒤집은 문자열 (칸 i의 str2[j-1]은 r[i + roff], roff = m - d)
+// cost : [삽입, 삭제, 교체, 전위]
+typedef struct {
+   int* cur;
+   const int* d1, * d2, * d4;
+   const unsigned char* a, * r;
+   int roff;
+   int cost[4];
+} DIAG_ARGS;
+
+// 반대각선의 칸 i ~ hi를 하나씩 계산한다.
+// return value : 다음에 계산할 칸 (hi + 1)
+static int _diag_scalar(const DIAG_ARGS* g, int i, int hi) {
+   for (; i <= hi; ++i) {
+      int b = g->r[i + g->roff];
+      int v = g->d2[i - 1] + ((g->a[i] == b) ? 0 : g->cost[2]);
+
+      if (g->d1[i] + g->cost[0] < v)
+         v = g->d1[i] + g->cost[0];
+      if (g->d1[i - 1] + g->cost[1] < v)
+         v = g->d1[i - 1] + g->cost[1];
+      if (g->a[i] == g->r[i + g->roff + 1] && g->a[i - 1] == b && g->d4[i - 2] + g->cost[3] < v)
+         v = g->d4[i - 2] + g->cost[3];
+      g->cur[i] = v;
+   }
+   return i;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DIAG_X86
+#include <immintrin.h>
+
+// 칸 i부터 4칸씩 SSE4.1로 계산한다. (남은 칸은 _diag_scalar)
+__attribute__((target("sse4.1")))
+static int _diag_sse41(const DIAG_ARGS* g, int i, int hi) {
+   __m128i ins = _mm_set1_epi32(g->cost[0]);
+   __m128i del = _mm_set1_epi32(g->cost[1]);
+   __m128i sub = _mm_set1_epi32(g->cost[2]);
+   __m128i tr = _mm_set1_epi32(g->cost[3]);
+
+   for (; i + 3 <= hi; i += 4) {
+      const unsigned char* rp = g->r + i + g->roff;
+      int32_t x[4];
+      memcpy(&x[0], g->a + i, 4); memcpy(&x[1], g->a + i - 1, 4);
+      memcpy(&x[2], rp, 4); memcpy(&x[3], rp + 1, 4);
+      __m128i a0 = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(x[0]));
+      __m128i a1 = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(x[1]));
+      __m128i b0 = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(x[2]));
+      __m128i b1 = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(x[3]));
+
+      __m128i v = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(g->d2 + i - 1)),
+         _mm_andnot_si128(_mm_cmpeq_epi32(a0, b0), sub));
+      v = _mm_min_epi32(v, _mm_add_epi32(_mm_loadu_si128((const __m128i*)(g->d1 + i)), ins));
+      v = _mm_min_epi32(v, _mm_add_epi32(_mm_loadu_si128((const __m128i*)(g->d1 + i - 1)), del));
+
+      __m128i swap = _mm_and_si128(_mm_cmpeq_epi32(a0, b1), _mm_cmpeq_epi32(a1, b0));
+      __m128i t = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(g->d4 + i - 2)), tr);
+      v = _mm_blendv_epi8(v, _mm_min_epi32(v, t), swap);
+      _mm_storeu_si128((__m128i*)(g->cur + i), v);
+   }
+   return i;
+}
+
+// 칸 i부터 8칸씩 AVX2로 계산한다. (남은 칸은 _diag_scalar)
+__attribute__((target("avx2")))
+static int _diag_avx2(const DIAG_ARGS* g, int i, int hi) {
+   __m256i ins = _mm256_set1_epi32(g->cost[0]);
+   __m256i del = _mm256_set1_epi32(g->cost[1]);
+   __m256i sub = _mm256_set1_epi32(g->cost[2]);
+   __m256i tr = _mm256_set1_epi32(g->cost[3]);
+
+   for (; i + 7 <= hi; i += 8) {
+      const unsigned char* rp = g->r + i + g->roff;
+      __m256i a0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(g->a + i)));
+      __m256i a1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(g->a + i - 1)));
+      __m256i b0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)rp));
+      __m256i b1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(rp + 1)));
+
+      __m256i v = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(g->d2 + i - 1)),
+         _mm256_andnot_si256(_mm256_cmpeq_epi32(a0, b0), sub));
+      v = _mm256_min_epi32(v, _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(g->d1 + i)), ins));
+      v = _mm256_min_epi32(v, _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(g->d1 + i - 1)), del));
+
+      __m256i swap = _mm256_and_si256(_mm256_cmpeq_epi32(a0, b1), _mm256_cmpeq_epi32(a1, b0));
+      __m256i t = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(g->d4 + i - 2)), tr);
+      v = _mm256_blendv_epi8(v, _mm256_min_epi32(v, t), swap);
+      _mm256_storeu_si256((__m256i*)(g->cur + i), v);
+   }
+   return i;
+}
+#endif
+
+// 반대각선 단위로 가중치 최소편집거리를 계산한다.
+int min_editdistance_simd(char* str1, char* str2, const COST_MODEL* cost) {
+   int n = strlen(str1);
+   int m = strlen(str2);
+   int (*kernel)(const DIAG_ARGS*, int, int) = NULL;
+   DIAG_ARGS g;
+   int d, i;
+
+   // 범위 밖의 칸은 INF (더해도 넘치지 않을 만큼 큰 값)
+   const int INF = INT_MAX / 4;
+
+   cost = _cost_model(cost);
+   if (cost->matrix != NULL)
+      return min_editdistance_linear(str1, str2, cost);
+   g.cost[0] = cost->ins; g.cost[1] = cost->del;
+   g.cost[2] = cost->sub; g.cost[3] = (cost->trans >= 0) ? cost->trans : INF;
+
+   // 짧은 문자열을 str1로 (반대각선의 길이가 min(n, m) + 1)
+   if (n > m) {
+      char* tmp = str1; str1 = str2; str2 = tmp;
+      int t = n; n = m; m = t;
+      g.cost[0] = cost->del; g.cost[1] = cost->ins;
+   }
+   if (n == 0)
+      return m * g.cost[0];
+
+#ifdef DIAG_X86
+   if (__builtin_cpu_supports("avx2"))
+      kernel = _diag_avx2;
+   else if (__builtin_cpu_supports("sse4.1"))
+      kernel = _diag_sse41;
+#endif
+
+   // 반대각선 다섯 개 (d, d-1 ~ d-4), 앞에 한 칸 (i = -1)과 뒤에 벡터 길이만큼의 여유
+   int stride = n + 16;
+   int* diags = (int*)dp_workspace(sizeof(int) * 5 * stride + (n + 16) + (m + 16));
+   if (diags == NULL)
+      return -1;
+   unsigned char* a = (unsigned char*)(diags + 5 * stride);
+   unsigned char* r = a + n + 16;
+
+   for (i = 0; i < 5 * stride; ++i)
+      diags[i] = INF;
+   int* buf[5];
+   for (i = 0; i < 5; ++i)
+      buf[i] = diags + i * stride + 1;
+
+   memset(a, 0, n + 16);
+   memcpy(a + 1, str1, n);
+   memset(r, 0, m + 16);
+   for (i = 0; i < m; ++i)
+      r[i] = str2[m - 1 - i];
+   g.a = a;
+   g.r = r;
+
+   buf[0][0] = 0;
+   for (d = 1; d <= n + m; ++d) {
+      // buf[0] : d-1, buf[1] : d-2, buf[3] : d-4, buf[4] : 이번 반대각선
+      int* cur = buf[4];
+      int lo = (d - m > 1) ? d - m : 1;
+      int hi = (d - 1 < n) ? d - 1 : n;
+
+      g.cur = cur;
+      g.d1 = buf[0];
+      g.d2 = buf[1];
+      g.d4 = buf[3];
+      g.roff = m - d;
+
+      i = lo;
+      if (kernel != NULL)
+         i = kernel(&g, i, hi);
+      _diag_scalar(&g, i, hi);
+
+      // 경계 (i = 0 또는 j = 0)와 범위 바로 뒤의 칸 (d+4의 전위 연산이 j = -1로 읽음)
+      if (d <= m)
+         cur[0] = d * g.cost[0];
+      if (d <= n)
+         cur[d] = d * g.cost[1];
+      if (d < n)
+         cur[d + 1] = INF;
+      cur[-1] = INF;
+
+      buf[4] = buf[3]; buf[3] = buf[2]; buf[2] = buf[1]; buf[1] = buf[0]; buf[0] = cur;
+   }
+
+   return buf[0][n];
+}
+
+// 비용 모델에 맞는 커널을 골라 최소편집거리를 계산한다.
+int min_editdistance_dispatch(char* str1, char* str2, const COST_MODEL* cost) {
+   cost = _cost_model(cost);
+   if (_cost_is_unit(cost))
+      return min_editdistance_bitparallel(str1, str2, cost);
+   if (cost->matrix == NULL)
+      return min_editdistance_simd(str1, str2, cost);
+   return min_editdistance_linear(str1, str2, cost);
+}
+
+// "ins,del,sub,trans"로 비용 모델을 정한다.
+int cost_model_parse(COST_MODEL* cost, const char* spec) {
+   int v[4], i;
+   const char* p = spec;
+   char* end;
+
+   for (i = 0; i < 4; ++i) {
+      if (i == 3 && p[0] == '-' && p[1] == '\0') {
+         v[i] = COST_NO_TRANSPOSE;
+         p++;
+         break;
+      }
+      long x = strtol(p, &end, 10);
+      if (end == p || x < 0 || x > INT_MAX / 16)
+         return -1;
+      v[i] = (int)x;
+      p = end;
+      if (i < 3 && *p++ != ',')
+         return -1;
+   }
+   if (*p != '\0' || v[0] < 1 || v[1] < 1)
+      return -1;
+
+   cost->ins = v[0];
+   cost->del = v[1];
+   cost->sub = v[2];
+   cost->trans = v[3];
+   return 0;
+}
+
+// 교체 비용 행렬을 읽는다.
+int cost_model_load_matrix(COST_MODEL* cost, const char* path) {
+   char line[256];
+   int a, b;
+
+   FILE* fp = fopen(path, "rt");
+   if (fp == NULL)
+      return -1;
+   int* matrix = (int*)malloc(sizeof(int) * 256 * 256);
+   if (matrix == NULL) {
+      fclose(fp);
+      return -1;
+   }
+   for (a = 0; a < 256; ++a)
+      for (b = 0; b < 256; ++b)
+         matrix[a * 256 + b] = (a == b) ? 0 : cost->sub;
+
+   while (fgets(line, sizeof(line), fp) != NULL) {
+      char x, y;
+      int c;
+
+      if (line[0] == '#' || line[0] == '\n')
+         continue;
+      if (sscanf(line, " %c %c %d", &x, &y, &c) != 3 || c < 0 || c > INT_MAX / 16) {
+         free(matrix);
+         fclose(fp);
+         return -1;
+      }
+      matrix[(unsigned char)x * 256 + (unsigned char)y] = c;
+   }
+   fclose(fp);
+
+   free(cost->matrix);
+   cost->matrix = matrix;
+   return 0;
+}
+
+void cost_model_free(COST_MODEL* cost) {
+   free(cost->matrix);
+   cost->matrix = NULL;
+}
+
+// 빈 트라이를 만든다.
+TRIE* trie_create(void) {
+   TRIE* trie = (TRIE*)calloc(1, sizeof(TRIE));
+
+   if (trie != NULL)
+      trie->root.word = -1;
+   return trie;
+}
+
+// 트라이에 단어를 넣는다.
+int trie_insert(TRIE* trie, const char* word) {
+   TRIE_NODE* node = &trie->root;
+   const unsigned char* p;
+
+   for (p = (const unsigned char*)word; *p; ++p) {
+      TRIE_NODE** link = &node->child;
+
+      while (*link != NULL && (*link)->ch < *p)
+         link = &(*link)->sibling;
+      if (*link == NULL || (*link)->ch != *p) {
+         TRIE_NODE* child = (TRIE_NODE*)malloc(sizeof(TRIE_NODE));
+         if (child == NULL)
+            return -1;
+         child->child = NULL;
+         child->sibling = *link;
+         child->word = -1;
+         child->ch = *p;
+         *link = child;
+      }
+      node = *link;
+   }
+   if (node->word >= 0)
+      return node->word;
+
+   if (trie->num_words == trie->capacity) {
+      int capacity = trie->capacity ? 2 * trie->capacity : 64;
+      char** words = (char**)realloc(trie->words, sizeof(char*) * capacity);
+      if (words == NULL)
+         return -1;
+      trie->words = words;
+      trie->capacity = capacity;
+   }
+   int len = p - (const unsigned char*)word;
+   char* copy = (char*)malloc(len + 1);
+   if (copy == NULL)
+      return -1;
+   memcpy(copy, word, len + 1);
+   trie->words[trie->num_words] = copy;
+   if (len > trie->max_len)
+      trie->max_len = len;
+   node->word = trie->num_words;
+   return trie->num_words++;
+}
+
+static void _trie_free(TRIE_NODE* node) {
+   while (node != NULL) {
+      TRIE_NODE* next = node->sibling;
+      _trie_free(node->child);
+      free(node);
+      node = next;
+   }
+}
+
+// 트라이와 단어들을 해제한다.
+void trie_destroy(TRIE* trie) {
+   int i;
+
+   if (trie == NULL)
+      return;
+   _trie_free(trie->root.child);
+   for (i = 0; i < trie->num_words; ++i)
+      free(trie->words[i]);
+   free(trie->words);
+   free(trie);
+}
+
+// 검색 상태
+typedef struct {
+   TRIE* trie;
+   const char* query;
+   const COST_MODEL* cost;
+   int m;                 // 질의의 길이
+   int* rows;             // 깊이 i의 DP 행 = rows + i * (m + 1)
+   int k;
+   int topk;
+   TRIE_MATCH* matches;
+   int num, capacity;
+   int error;
+} TRIE_SEARCH;
+
+// 지금 찾고 있는 거리의 한계 (topk개를 다 찾았으면 topk번째보다 가까워야 함)
+static int _trie_bound(const TRIE_SEARCH* s) {
+   if (s->topk > 0 && s->num == s->topk && s->matches[s->num - 1].distance - 1 < s->k)
+      return s->matches[s->num - 1].distance - 1;
+   return s->k;
+}
+
+// 결과를 넣는다. topk 모드에서는 거리순을 유지하며 topk개만 남긴다. (같은 거리면 먼저 찾은 단어가 앞)
+static void _trie_report(TRIE_SEARCH* s, int word, int distance) {
+   int pos;
+
+   if (s->num == s->capacity) {
+      int capacity = s->capacity ? 2 * s->capacity : 16;
+      TRIE_MATCH* matches = (TRIE_MATCH*)realloc(s->matches, sizeof(TRIE_MATCH) * capacity);
+      if (matches == NULL) {
+         s->error = 1;
+         return;
+      }
+      s->matches = matches;
+      s->capacity = capacity;
+   }
+   pos = s->num++;
+   if (s->topk > 0) {
+      while (pos > 0 && s->matches[pos - 1].distance > distance) {
+         s->matches[pos] = s->matches[pos - 1];
+         pos--;
+      }
+      if (s->num > s->topk)
+         s->num = s->topk;
+      if (pos >= s->topk)
+         return;
+   }
+   s->matches[pos].word = s->trie->words[word];
+   s->matches[pos].distance = distance;
+}
+
+// 노드 (깊이 i, 문자 c)의 DP 행을 계산하고 자식들로 내려간다.
+// 행은 단어의 문자, 열은 질의의 문자이므로 아래로 가면 삽입, 오른쪽으로 가면 삭제 (min_editdistance(query, 단어))
+// prev_ch : 부모 노드의 문자, prev_min : 부모 행의 최소값
+static void _trie_search(TRIE_SEARCH* s, TRIE_NODE* node, int i, unsigned char prev_ch, int prev_min) {
+   const unsigned char* q = (const unsigned char*)s->query;
+   int m = s->m;
+   int* cur = s->rows + i * (m + 1);
+   int* prev = cur - (m + 1);
+   int* prev2 = (i > 1) ? prev - (m + 1) : NULL;
+   unsigned char c = node->ch;
+   const COST_MODEL* cost = s->cost;
+   int j;
+
+   cur[0] = i * cost->ins;
+   int row_min = cur[0];
+   for (j = 1; j < m + 1; ++j) {
+      unsigned char b = q[j - 1];
+      int v = __GetMin3(prev[j] + cost->ins, cur[j - 1] + cost->del, prev[j - 1] + _sub_cost(cost, b, c));
+
+      if (cost->trans >= 0 && i > 1 && j > 1 && c == q[j - 2] && prev_ch == b && prev2[j - 2] + cost->trans < v)
+         v = prev2[j - 2] + cost->trans;
+      cur[j] = v;
+      if (v < row_min)
+         row_min = v;
+   }
+
+   if (node->word >= 0 && cur[m] <= _trie_bound(s))
+      _trie_report(s, node->word, cur[m]);
+
+   // 아래 행들은 이 행과 부모 행(전위 연산)의 최소값보다 작아질 수 없음
+   TRIE_NODE* child;
+   for (child = node->child; child != NULL && !s->error; child = child->sibling) {
+      if ((row_min < prev_min ? row_min : prev_min) > _trie_bound(s))
+         break;
+      _trie_search(s, child, i + 1, c, row_min);
+   }
+}
+
+static int _compare_matches(const void* x, const void* y) {
+   const TRIE_MATCH* a = (const TRIE_MATCH*)x;
+   const TRIE_MATCH* b = (const TRIE_MATCH*)y;
+
+   if (a->distance != b->distance)
+      return (a->distance < b->distance) ? -1 : 1;
+   return strcmp(a->word, b->word);
+}
+
+// query에서 최소편집거리가 k 이하인 단어들 (또는 가장 가까운 topk개)을 찾는다.
+int trie_search(TRIE* trie, const char* query, const COST_MODEL* cost, int k, int topk, TRIE_MATCH** matches) {
+   TRIE_SEARCH s;
+   int j;
+
+   memset(&s, 0, sizeof(s));
+   s.trie = trie;
+   s.query = query;
+   s.cost = _cost_model(cost);
+   s.m = strlen(query);
+   s.k = k;
+   s.topk = topk;
+   *matches = NULL;
+
+   s.rows = (int*)dp_workspace(sizeof(int) * (trie->max_len + 1) * (s.m + 1));
+   if (s.rows == NULL)
+      return -1;
+   for (j = 0; j < s.m + 1; ++j)
+      s.rows[j] = j * s.cost->del;
+
+   if (trie->root.word >= 0 && s.rows[s.m] <= k)
+      _trie_report(&s, trie->root.word, s.rows[s.m]);
+
+   // 자식은 문자 순이므로 단어를 사전순으로 방문하고, topk 모드에서 거리가 같으면 사전순으로 앞선 단어가 남는다.
+   TRIE_NODE* child;
+   for (child = trie->root.child; child != NULL && !s.error; child = child->sibling) {
+      if (s.rows[0] > _trie_bound(&s))
+         break;
+      _trie_search(&s, child, 1, 0, s.rows[0]);
+   }
+
+   if (s.error) {
+      free(s.matches);
+      return -1;
+   }
+   if (s.num > 1)
+      qsort(s.matches, s.num, sizeof(TRIE_MATCH), _compare_matches);
+   *matches = s.matches;
+   return s.num;
+}
+
+// 배치 하나 (읽은 쌍들과 결과)
+typedef struct {
+   char* text;          // 쌍들의 문자열이 차례로 복사된 버퍼 (입력 블록은 다음 줄을 읽으면 재사용되므로)
+   size_t text_size, text_capacity;
+   size_t* offsets;     // 쌍마다 [문자열1, 문자열2]의 text 내 위치
+   char* ops;           // 정렬 (align일 때만), 쌍 p의 정렬은 ops + offsets[2p] (두 문자열의 자리에 들어감)
+   size_t ops_capacity;
+   int* distance;       // 쌍마다 최소편집거리, 메모리가 부족하면 -1
+   int num_pairs;
+   int chunk_size;      // 청크 하나의 쌍 수
+   int align;
+   const COST_MODEL* cost;
+} BATCH;
+
+// 스레드마다 남은 작업(청크) 범위 [head, tail), 주인은 앞에서, 훔치는 스레드는 뒤에서 가져간다.
+typedef struct {
+   pthread_mutex_t lock;
+   int head, tail;
+} WORK_DEQUE;
+
+typedef struct BATCH_POOL BATCH_POOL;
+
+typedef struct {
+   BATCH_POOL* pool;
+   int id;
+} BATCH_WORKER;
+
+struct BATCH_POOL {
+   pthread_mutex_t lock;
+   pthread_cond_t work_cv;   // 새 배치 또는 종료
+   pthread_cond_t done_cv;   // 모든 스레드가 배치를 마침
+   BATCH* batch;
+   int generation;           // 배치를 넘길 때마다 증가
+   int num_done;
+   int quit;
+   int num_threads;
+   pthread_t threads[MAX_THREADS];
+   BATCH_WORKER workers[MAX_THREADS];
+   WORK_DEQUE deques[MAX_THREADS];
+};
+
+// 덱에서 청크 하나를 꺼낸다. from_tail이면 뒤에서 (훔치기)
+// return value : 청크 번호, 비어 있으면 -1
+static int _deque_pop(WORK_DEQUE* dq, int from_tail) {
+   int chunk = -1;
+
+   pthread_mutex_lock(&dq->lock);
+   if (dq->head < dq->tail)
+      chunk = from_tail ? --dq->tail : dq->head++;
+   pthread_mutex_unlock(&dq->lock);
+   return chunk;
+}
+
+// 청크 하나의 쌍들을 계산한다.
+static void _batch_chunk(BATCH* batch, int chunk) {
+   int p = chunk * batch->chunk_size;
+   int end = p + batch->chunk_size;
+
+   if (end > batch->num_pairs)
+      end = batch->num_pairs;
+   for (; p < end; ++p) {
+      char* s1 = batch->text + batch->offsets[2 * p];
+      char* s2 = batch->text + batch->offsets[2 * p + 1];
+
+      if (batch->align)
+         batch->distance[p] = min_editdistance_align(s1, s2, batch->cost, batch->ops + batch->offsets[2 * p]);
+      else
+         batch->distance[p] = min_editdistance_dispatch(s1, s2, batch->cost);
+   }
+}
+
+static void* _batch_worker(void* arg) {
+   BATCH_WORKER* worker = (BATCH_WORKER*)arg;
+   BATCH_POOL* pool = worker->pool;
+   int generation = 0;
+   int i, chunk;
+
+   for (;;) {
+      pthread_mutex_lock(&pool->lock);
+      while (!pool->quit && pool->generation == generation)
+         pthread_cond_wait(&pool->work_cv, &pool->lock);
+      if (pool->quit) {
+         pthread_mutex_unlock(&pool->lock);
+         dp_workspace_free();
+         return NULL;
+      }
+      generation = pool->generation;
+      BATCH* batch = pool->batch;
+      pthread_mutex_unlock(&pool->lock);
+
+      // 자기 덱을 앞에서부터 처리하고, 비면 다른 덱의 뒤쪽에서 훔친다.
+      for (;;) {
+         chunk = _deque_pop(&pool->deques[worker->id], 0);
+         for (i = 1; chunk < 0 && i < pool->num_threads; ++i)
+            chunk = _deque_pop(&pool->deques[(worker->id + i) % pool->num_threads], 1);
+         if (chunk < 0)
+            break;
+         _batch_chunk(batch, chunk);
+      }
+
+      pthread_mutex_lock(&pool->lock);
+      if (++pool->num_done == pool->num_threads)
+         pthread_cond_signal(&pool->done_cv);
+      pthread_mutex_unlock(&pool->lock);
+   }
+}
+
+// 배치의 청크들을 스레드의 덱에 연속 구간으로 나눠 주고 모두 끝날 때까지 기다린다.
+// 쌍이 적으면 (긴 문자열) 스레드마다 청크가 여러 개 돌아가도록 청크를 줄인다.
+static void _batch_run(BATCH_POOL* pool, BATCH* batch) {
+   int t;
+
+   batch->chunk_size = (batch->num_pairs + 4 * pool->num_threads - 1) / (4 * pool->num_threads);
+   if (batch->chunk_size > BATCH_CHUNK)
+      batch->chunk_size = BATCH_CHUNK;
+   if (batch->chunk_size < 1)
+      batch->chunk_size = 1;
+   int num_chunks = (batch->num_pairs + batch->chunk_size - 1) / batch->chunk_size;
+
+   for (t = 0; t < pool->num_threads; ++t) {
+      pthread_mutex_lock(&pool->deques[t].lock);
+      pool->deques[t].head = (int)((long long)num_chunks * t / pool->num_threads);
+      pool->deques[t].tail = (int)((long long)num_chunks * (t + 1) / pool->num_threads);
+      pthread_mutex_unlock(&pool->deques[t].lock);
+   }
+
+   pthread_mutex_lock(&pool->lock);
+   pool->batch = batch;
+   pool->num_done = 0;
+   pool->generation++;
+   pthread_cond_broadcast(&pool->work_cv);
+   while (pool->num_done < pool->num_threads)
+      pthread_cond_wait(&pool->done_cv, &pool->lock);
+   pthread_mutex_unlock(&pool->lock);
+}
+
+// 배치 버퍼에 문자열을 '\0'까지 덧붙인다.
+// return value : 덧붙인 위치, 메모리가 부족하면 (size_t)-1
+static size_t _batch_append(BATCH* batch, const char* s) {
+   size_t len = strlen(s) + 1;
+   size_t offset = batch->text_size;
+
+   if (batch->text_size + len > batch->text_capacity) {
+      size_t capacity = batch->text_capacity ? batch->text_capacity : 4096;
+      while (batch->text_size + len > capacity)
+         capacity *= 2;
+      char* text = (char*)realloc(batch->text, capacity);
+      if (text == NULL)
+         return (size_t)-1;
+      batch->text = text;
+      batch->text_capacity = capacity;
+   }
+   memcpy(batch->text + offset, s, len);
+   batch->text_size += len;
+   return offset;
+}
+
+// 출력 버퍼 (가득 차면 fwrite)
+typedef struct {
+   char* data;
+   size_t size;
+} OUTBUF;
+
+static void _out_flush(OUTBUF* out) {
+   fwrite(out->data, 1, out->size, stdout);
+   out->size = 0;
+}
+
+static void _out_str(OUTBUF* out, const char* s, size_t len) {
+   if (out->size + len > OUTBUF_SIZE) {
+      _out_flush(out);
+      if (len > OUTBUF_SIZE) {
+         fwrite(s, 1, len, stdout);
+         return;
+      }
+   }
+   memcpy(out->data + out->size, s, len);
+   out->size += len;
+}
+
+static void _out_int(OUTBUF* out, int v) {
+   char digits[16];
+   int len = 0;
+   unsigned int u = (v < 0) ? -(unsigned int)v : (unsigned int)v;
+
+   do {
+      digits[sizeof(digits) - 1 - len++] = '0' + u % 10;
+      u /= 10;
+   } while (u > 0);
+   if (v < 0)
+      digits[sizeof(digits) - 1 - len++] = '-';
+   _out_str(out, digits + sizeof(digits) - len, len);
+}
+
+// 여러 스레드로 최소편집거리를 계산하고 입력 순서대로 출력한다.
+int min_editdistance_batch(int num_threads, int align, const COST_MODEL* cost) {
+   BATCH_POOL pool;
+   BATCH batch;
+   OUTBUF out;
+   LINE_READER in;
+   char* s1, * s2;
+   int t, p, eof = 0, result = 0;
+
+   memset(&batch, 0, sizeof(batch));
+   batch.align = align;
+   batch.cost = cost;
+   batch.offsets = (size_t*)malloc(2 * BATCH_PAIRS * sizeof(size_t));
+   batch.distance = (int*)malloc(BATCH_PAIRS * sizeof(int));
+   out.data = (char*)malloc(OUTBUF_SIZE);
+   out.size = 0;
+   if (batch.offsets == NULL || batch.distance == NULL || out.data == NULL || reader_init(&in, stdin) < 0) {
+      fprintf(stderr, "Error : not enough memory!\n");
+      free(batch.offsets); free(batch.distance); free(out.data);
+      return -1;
+   }
+
+   memset(&pool, 0, sizeof(pool));
+   pthread_mutex_init(&pool.lock, NULL);
+   pthread_cond_init(&pool.work_cv, NULL);
+   pthread_cond_init(&pool.done_cv, NULL);
+   for (t = 0; t < num_threads; ++t)
+      pthread_mutex_init(&pool.deques[t].lock, NULL);
+   for (t = 0; t < num_threads; ++t) {
+      pool.workers[t].pool = &pool;
+      pool.workers[t].id = t;
+      if (pthread_create(&pool.threads[t], NULL, _batch_worker, &pool.workers[t]) != 0)
+         break;
+   }
+   pool.num_threads = t;
+   if (t == 0) {
+      fprintf(stderr, "Error : cannot create threads!\n");
+      result = -1;
+      eof = 1;
+   }
+
+   while (!eof) {
+      // 배치 읽기
+      batch.num_pairs = 0;
+      batch.text_size = 0;
+      while (batch.num_pairs < BATCH_PAIRS) {
+         if (!read_pair(&in, &s1, &s2)) {
+            eof = 1;
+            if (in.error) {
+               fprintf(stderr, "Error : not enough memory!\n");
+               result = -1;
+            }
+            break;
+         }
+         size_t o1 = _batch_append(&batch, s1);
+         size_t o2 = (o1 != (size_t)-1) ? _batch_append(&batch, s2) : (size_t)-1;
+         if (o2 == (size_t)-1) {
+            fprintf(stderr, "Error : not enough memory!\n");
+            result = -1;
+            eof = 1;
+            break;
+         }
+         batch.offsets[2 * batch.num_pairs] = o1;
+         batch.offsets[2 * batch.num_pairs + 1] = o2;
+         batch.num_pairs++;
+      }
+      if (result < 0 || batch.num_pairs == 0)
+         break;
+
+      // 정렬 버퍼는 배치 문자열 버퍼만큼 (가장 큰 배치의 크기로만 늘어남)
+      if (align && batch.ops_capacity < batch.text_capacity) {
+         free(batch.ops);
+         batch.ops = (char*)malloc(batch.text_capacity);
+         batch.ops_capacity = (batch.ops != NULL) ? batch.text_capacity : 0;
+         if (batch.ops == NULL) {
+            fprintf(stderr, "Error : not enough memory!\n");
+            result = -1;
+            break;
+         }
+      }
+
+      _batch_run(&pool, &batch);
+
+      // 입력 순서대로 출력
+      for (p = 0; p < batch.num_pairs; ++p) {
+         if (batch.distance[p] < 0) {
+            fprintf(stderr, "Error : not enough memory!\n");
+            result = -1;
+            break;
+         }
+         _out_int(&out, batch.distance[p]);
+         if (align) {
+            _out_str(&out, "\t", 1);
+            char* ops = batch.ops + batch.offsets[2 * p];
+            _out_str(&out, ops, strlen(ops));
+         }
+         _out_str(&out, "\n", 1);
+      }
+      if (result < 0)
+         break;
+   }
+   _out_flush(&out);
+   fflush(stdout);
+
+   pthread_mutex_lock(&pool.lock);
+   pool.quit = 1;
+   pthread_cond_broadcast(&pool.work_cv);
+   pthread_mutex_unlock(&pool.lock);
+   for (t = 0; t < pool.num_threads; ++t)
+      pthread_join(pool.threads[t], NULL);
+   for (t = 0; t < num_threads; ++t)
+      pthread_mutex_destroy(&pool.deques[t].lock);
+   pthread_cond_destroy(&pool.done_cv);
+   pthread_cond_destroy(&pool.work_cv);
+   pthread_mutex_destroy(&pool.lock);
+
+   reader_free(&in);
+   free(batch.text);
+   free(batch.offsets);
+   free(batch.distance);
+   free(batch.ops);
+   free(out.data);
+   return result;
+}
+
+// 벤치마크의 알파벳, 변이율, 커널
+static const char* _bench_alphabets[] = { "dna", "ascii", "bytes" };
+static const double _bench_rates[] = { 0.001, 0.01, 0.1, -1 };  // -1 : str2를 str1과 따로 만듦
+enum { BENCH_MATRIX, BENCH_LINEAR, BENCH_ALIGN, BENCH_BITPARALLEL, BENCH_SIMD, BENCH_BOUNDED, NUM_BENCH_KERNELS };
+static const char* _bench_kernels[] = { "matrix", "linear", "align", "bitparallel", "simd", "bounded" };
+
+// 단조 증가하는 시간 (초)
+static double _bench_time(void) {
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 프로세스가 시작한 뒤 지금까지의 최대 RSS (KB, 줄어들지 않음)
+static long _peak_rss_kb(void) {
+   struct rusage ru;
+
+   if (getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+   return ru.ru_maxrss;
+}
+
+// 벤치마크용 난수 (splitmix64, seed가 같으면 항상 같은 문자열)
+static uint64_t _bench_rand(uint64_t* state) {
+   uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   return z ^ (z >> 31);
+}
+
+// alphabet의 임의 문자 하나 (바이트 알파벳은 '\0'을 뺀 1 ~ 255)
+static char _bench_char(int alphabet, uint64_t* state) {
+   uint64_t r = _bench_rand(state) >> 32;
+
+   if (alphabet == 0)
+      return "ACGT"[r & 3];
+   if (alphabet == 1)
+      return (char)(' ' + r % 95);
+   return (char)(1 + r % 255);
+}
+
+// str1을 변이율 rate로 바꾸어 str2를 만든다. 위치마다 rate의 확률로 교체, 삽입, 삭제, 전위 중 하나를 적용
+// return value : 적용한 연산의 수
+static int _bench_mutate(const char* str1, int n, char* str2, double rate, int alphabet, uint64_t* state) {
+   uint64_t threshold = (uint64_t)(rate * 18446744073709551615.0);
+   int i = 0, j = 0, edits = 0;
+
+   while (i < n) {
+      if (_bench_rand(state) >= threshold) {
+         str2[j++] = str1[i++];
+         continue;
+      }
+      ++edits;
+      switch (_bench_rand(state) & 3) {
+      case 0: // 교체
+         str2[j++] = _bench_char(alphabet, state);
+         ++i;
+         break;
+      case 1: // 삽입
+         str2[j++] = _bench_char(alphabet, state);
+         break;
+      case 2: // 삭제
+         ++i;
+         break;
+      default: // 전위 (마지막 문자면 교체)
+         if (i + 1 < n) {
+            str2[j++] = str1[i + 1];
+            str2[j++] = str1[i];
+            i += 2;
+         }
+         else {
+            str2[j++] = _bench_char(alphabet, state);
+            ++i;
+         }
+         break;
+      }
+   }
+   str2[j] = '\0';
+   return edits;
+}
+
+// 커널이 계산할 대략의 칸 수 (비트 병렬은 64칸을 한 워드로, 대각 띠는 띠 안의 칸만), 비용 모델에 맞지 않는 커널은 -1
+// 커널이 실제로 계산하는 칸 수 (대각 띠는 띠 안의 칸만, Hirschberg는 단계마다 절반씩 다시 계산하므로 약 2배,
+// 비트 병렬은 한 워드로 64칸씩 모든 칸을 계산)
+static double _bench_work(int kernel, const COST_MODEL* cost, int n, int m, int k) {
+   if (kernel == BENCH_ALIGN)
+      return 2.0 * n * m;
+   if (kernel == BENCH_BOUNDED) {
+      double width = (double)(k / cost->del) + k / cost->ins + 1;
+      return (double)n * ((width < m + 1) ? width : m + 1);
+   }
+   return (double)n * m;
+}
+
+static double _bench_cells(int kernel, const COST_MODEL* cost, int n, int m, int k) {
+   int lo = (n < m) ? n : m, hi = (n < m) ? m : n;
+
+   switch (kernel) {
+   case BENCH_BITPARALLEL:
+      // 한 워드를 갱신하는 비용을 칸 8개 정도로 봄
+      return _cost_is_unit(cost) ? (double)hi * ((lo + 63) / 64) * 8 : -1;
+   case BENCH_SIMD:
+      return (cost->matrix == NULL) ? (double)n * m : -1;
+   case BENCH_BOUNDED:
+      return _bench_work(kernel, cost, n, m, k);
+   default:
+      return (double)n * m;
+   }
+}
+
+// 커널을 한 번 실행한다.
+// return value : 최소편집거리, 메모리가 부족하면 -1
+static int _bench_call(int kernel, char* str1, char* str2, const COST_MODEL* cost, int k, char* ops) {
+   int distance = -1;
+
+   switch (kernel) {
+   case BENCH_MATRIX: {
+      unsigned char* op_matrix = min_editdistance_matrix(str1, str2, cost, &distance);
+      if (op_matrix == NULL)
+         return -1;
+      free(op_matrix);
+      return distance;
+   }
+   case BENCH_LINEAR:
+      return min_editdistance_linear(str1, str2, cost);
+   case BENCH_ALIGN:
+      return min_editdistance_align(str1, str2, cost, ops);
+   case BENCH_BITPARALLEL:
+      return min_editdistance_bitparallel(str1, str2, cost);
+   case BENCH_SIMD:
+      return min_editdistance_simd(str1, str2, cost);
+   default:
+      return min_editdistance_bounded(str1, str2, cost, k);
+   }
+}
+
+// 한 쌍에 대해 커널들을 재어 한 줄씩 출력
+// return value : 모든 커널의 거리가 같으면 1, 아니면 0
+static int _bench_pair(FILE* outfp, const COST_MODEL* cost, int alphabet, int rate, char* str1, char* str2, int k, char* ops) {
+   int n = strlen(str1);
+   int m = strlen(str2);
+   int expected = -1;
+   char rate_name[16];
+
+   if (_bench_rates[rate] < 0)
+      strcpy(rate_name, "random");
+   else
+      sprintf(rate_name, "%g", _bench_rates[rate]);
+
+   for (int kernel = 0; kernel < NUM_BENCH_KERNELS; ++kernel) {
+      // 건너뛰는 커널도 이유를 적은 줄을 출력하여 비교에서 빠진 것이 보이도록 함
+      double cells = _bench_cells(kernel, cost, n, m, k);
+      const char* skip = NULL;
+      if (cells < 0)
+         skip = "skip:cost_model";
+      else if (kernel == BENCH_MATRIX && (double)(n + 1) * (m + 1) > BENCH_MAX_MATRIX)
+         skip = "skip:max_matrix";
+      else if (cells > BENCH_MAX_CELLS)
+         skip = "skip:max_cells";
+      if (skip != NULL) {
+         fprintf(outfp, "%s\t%d\t%s\t%s\t%s\t-\t-\t-\t-\t-\t-\t-\n",
+            _bench_alphabets[alphabet], n, rate_name, _bench_kernels[kernel], skip);
+         continue;
+      }
+
+      // 처음 실행에서 작업 공간이 이 커널에 필요한 만큼만 늘어나도록 비워 둠
+      dp_workspace_free();
+      double t = _bench_time();
+      int distance = _bench_call(kernel, str1, str2, cost, k, ops);
+      long reps = 1;
+      size_t mem = _workspace_size;
+      if (kernel == BENCH_MATRIX)
+         mem += (size_t)(n + 1) * (m + 1);
+      else if (kernel == BENCH_ALIGN)
+         mem += n + m + 1;
+
+      while (distance >= 0 && _bench_time() - t < BENCH_MIN_TIME) {
+         _bench_call(kernel, str1, str2, cost, k, ops);
+         ++reps;
+      }
+      t = (_bench_time() - t) / reps;
+
+      if (distance < 0) {
+         fprintf(stderr, "Error : not enough memory!\n");
+         return 0;
+      }
+      if (expected < 0)
+         expected = distance;
+      else if (distance != expected) {
+         fprintf(stderr, "Error : %s %s %d mismatch (%s: %d, expected %d)\n",
+            _bench_alphabets[alphabet], rate_name, n, _bench_kernels[kernel], distance, expected);
+         return 0;
+      }
+
+      fprintf(outfp, "%s\t%d\t%s\t%s\tok\t%d\t%ld\t%.4g\t%.1f\t%.1f\t%ld\t%ld\n",
+         _bench_alphabets[alphabet], n, rate_name, _bench_kernels[kernel], distance, reps, t,
+         _bench_work(kernel, cost, n, m, k) / t / 1e6, (double)n * m / t / 1e6, (long)((mem + 1023) / 1024), _peak_rss_kb());
+      fflush(outfp);
+   }
+   return 1;
+}
+
+int run_benchmark(FILE* outfp, const long* lengths, int num_lengths, const COST_MODEL* cost) {
+   int ok = 1;
+
+   cost = _cost_model(cost);
+
+   // 가장 비싼 연산 하나의 비용 (변이 수에 곱하면 거리의 상한)
+   int max_cost = cost->ins;
+   if (cost->del > max_cost) max_cost = cost->del;
+   if (cost->sub > max_cost) max_cost = cost->sub;
+   if (cost->trans > max_cost) max_cost = cost->trans;
+   for (int c = 0; cost->matrix != NULL && c < 256 * 256; ++c)
+      if (cost->matrix[c] > max_cost) max_cost = cost->matrix[c];
+
+   // 비교할 때 설정을 구분할 수 있도록 주석 줄로 출력
+   fprintf(outfp, "# cost=%d,%d,%d,%d matrix=%d diag=%s min_time=%g max_cells=%lld\n",
+      cost->ins, cost->del, cost->sub, cost->trans, cost->matrix != NULL,
+#ifdef DIAG_X86
+      __builtin_cpu_supports("avx2") ? "avx2" : __builtin_cpu_supports("sse4.1") ? "sse4.1" : "scalar",
+#else
+      "scalar",
+#endif
+      BENCH_MIN_TIME, BENCH_MAX_CELLS);
+   fprintf(outfp, "# mcells_per_s : cells the kernel computes (band only for bounded, about 2 * n * m for align), equiv_mcells_per_s : n * m full-matrix cells\n");
+   fprintf(outfp, "alphabet\tlength\tmutation\tkernel\tstatus\tdistance\treps\tseconds\tmcells_per_s\tequiv_mcells_per_s\tmem_kb\tcum_peak_rss_kb\n");
+
+   for (int l = 0; l < num_lengths && ok; ++l) {
+      int n = (int)lengths[l];
+      char* str1 = (char*)malloc(n + 1);
+      char* str2 = (char*)malloc(2 * (size_t)n + 1);
+      char* ops = (char*)malloc(3 * (size_t)n + 2);
+
+      if (str1 == NULL || str2 == NULL || ops == NULL) {
+         fprintf(stderr, "Error : not enough memory!\n");
+         ok = 0;
+      }
+
+      for (int alphabet = 0; alphabet < 3 && ok; ++alphabet) {
+         for (int rate = 0; rate < 4 && ok; ++rate) {
+            uint64_t state = ((uint64_t)n * 4 + alphabet) * 4 + rate;
+            long long k;
+            int i;
+
+            for (i = 0; i < n; ++i)
+               str1[i] = _bench_char(alphabet, &state);
+            str1[n] = '\0';
+
+            if (_bench_rates[rate] < 0) {
+               for (i = 0; i < n; ++i)
+                  str2[i] = _bench_char(alphabet, &state);
+               str2[n] = '\0';
+               k = (long long)n * max_cost;
+            }
+            else
+               k = (long long)_bench_mutate(str1, n, str2, _bench_rates[rate], alphabet, &state) * max_cost;
+
+            // 띠의 폭은 1 이상, 띠 안의 값이 넘치지 않도록 INT_MAX / 4 이하
+            if (k < 1) k = 1;
+            if (k > INT_MAX / 4) k = INT_MAX / 4;
+            ok = _bench_pair(outfp, cost, alphabet, rate, str1, str2, (int)k, ops);
+         }
+      }
+
+      free(str1);
+      free(str2);
+      free(ops);
+   }
+
+   return ok;
+}
@@ -6,28 +6,76 @@
 //  Edited Date : Jun 17, 2021
 
 #define BINARY_MODE
+#define BLOCK_MODE	// 블록 단위 병렬 압축 (BINARY_MODE에서만 사용, 컴파일 시 -pthread 옵션 필요)
+#define INTERLEAVED_MODE	// 허프만 블록을 4개의 비트열로 나누어 인코딩 (디코딩 시 4개의 비트열을 한 루프에서 번갈아 디코딩)
+//#define ORDER1_MODE	// 허프만 블록을 인코딩할 때 이전 문자를 문맥으로 하는 order-1 모델도 고려
+#define CODE_LEN_LIMIT	12	// 허프만 코드의 최대 길이 (9 ~ 56), 트리가 더 깊으면 package-merge로 길이를 제한
+
+#define _DEFAULT_SOURCE	// -std=c11 등에서도 madvise, strdup, clock_gettime 선언
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 typedef struct Node 
 { 
 	unsigned char	data;	// 문자	
 	int		freq; 			// 빈도
-	struct	Node *left;		// 왼쪽 서브트리 포인터
-	struct	Node *right; 	// 오른쪽 서브트리 포인터
+	short	left;			// 왼쪽 서브트리의 index (-1: 없음)
+	short	right; 			// 오른쪽 서브트리의 index (-1: 없음)
 } tNode;
 
+#define MAX_NODES	511		// leaf 256개 + 내부 노드 255개
+
+// 허프만 트리
+// 모든 노드를 고정 크기 배열(arena)에 저장하고 index로 연결 (노드별 malloc 없음)
+// leaf가 빈도순으로 먼저 저장되고, 내부 노드는 생성 순서대로 이어짐 (자식의 index < 부모의 index)
+typedef struct
+{
+	tNode	nodes[MAX_NODES];
+	int		num_leaves;
+	int		num_nodes;
+	int		root;			// root 노드의 index (-1: 빈 트리)
+} HUFFMAN_TREE;
+
 ////////////////////////////////////////////////////////////////////////////////
+#define HEAP_D	4	// 힙 노드의 자식 수 (d-ary 힙)
+
+// 힙 원소 : 키를 포인터 없이 원소 번호 옆에 저장하여 비교할 때 다른 메모리를 읽지 않음
+typedef struct
+{
+	long long	key;	// 우선순위 (작을수록 먼저)
+	int		item;		// 원소 번호 (0 ~ capacity-1)
+} HEAP_ENTRY;
+
+// 최소 d-ary 힙
+// index i의 자식은 HEAP_D * i + 1 ~ HEAP_D * i + HEAP_D, 부모는 (i - 1) / HEAP_D
+// 트리 높이가 낮고 자식들이 연속된 메모리에 있어 캐시 효율이 좋음
 typedef struct
 {
 	int	last;		// 힙에 저장된 마지막 element의 index
-	int	capacity;	// heapArr의 크기
-	tNode **heapArr;
+	int	capacity;	// heapArr의 크기 (원소 번호의 범위)
+	HEAP_ENTRY *heapArr;
+	int	*pos;		// 원소 번호별 heapArr에서의 index (-1: 힙에 없음), decrease-key에 사용
+	int	owned;		// heapCreate가 메모리를 할당했는지 여부
 } HEAP;
 
+// 호출한 쪽의 메모리(arr, pos : capacity개)로 빈 힙 초기화 (malloc 없음)
+void heapInit( HEAP *heap, HEAP_ENTRY *arr, int *pos, int capacity);
+
 // 힙 생성
 // 배열을 위한 메모리 할당 (capacity)
 // last = -1
@@ -36,64 +84,452 @@ HEAP *heapCreate( int capacity);
 // 최소힙 유지
 static void _reheapUp( HEAP *heap, int index);
 
-// 힙에 원소 삽입
+// 힙에 원소 삽입 (item은 힙에 없어야 함)
 // _reheapUp 함수 호출
-int heapInsert( HEAP *heap, tNode *data);
+int heapInsert( HEAP *heap, int item, long long key);
 
 // 최소힙 유지
 static void _reheapDown( HEAP *heap, int index);
 
 // 최소값 제거
 // _reheapDown 함수 호출
-tNode *heapDelete( HEAP *heap);
+// key : 제거한 원소의 키 저장 (NULL이면 저장하지 않음)
+// return value : 제거한 원소 번호, 빈 힙이면 -1
+int heapDelete( HEAP *heap, long long *key);
+
+// 힙의 내용을 items[0 ~ n-1] (키 keys[0 ~ n-1])로 바꾸고 O(n)에 힙을 구성 (bottom-up heapify)
+// return value : 성공 1, n이 capacity보다 크면 0
+int heapBuild( HEAP *heap, const int *items, const long long *keys, int n);
+
+// 힙에 있는 원소 item의 키를 key로 줄임
+// return value : 성공 1, item이 힙에 없거나 key가 현재 키보다 크면 0
+int heapDecreaseKey( HEAP *heap, int item, long long key);
 
 // 힙 메모리 해제
 void heapDestroy( HEAP *heap);
 
 ////////////////////////////////////////////////////////////////////////////////
-// 파일에 속한 각 문자(바이트)의 빈도 저장
-// return value : 파일에서 읽은 바이트 수
-int read_chars( FILE *fp, int *ch_freq);
+#define BITIO_BUFSIZE	65536	// 비트 입출력 버퍼의 크기 (바이트)
+
+// 비트 단위 출력기
+// 코드 비트를 64비트 누산기(acc)에 모았다가 바이트 단위로 버퍼에 옮기고, 버퍼가 차면 한 번에 fwrite
+// fp가 NULL이면 파일 대신 주어진 메모리에 출력
+typedef struct
+{
+	FILE	*fp;
+	unsigned long long acc;	// 아직 버퍼로 옮기지 않은 비트 (하위 nbits 비트가 유효)
+	int		nbits;			// acc에 저장된 비트 수
+	unsigned char *data;	// 출력 버퍼 (파일 출력이면 buf)
+	long	pos;			// data에 저장된 바이트 수
+	long	capacity;		// data의 크기
+	long	written;		// 파일에 기록한 바이트 수
+	unsigned char buf[BITIO_BUFSIZE];
+} BIT_WRITER;
+
+// 비트 단위 입력기
+// 블록 단위로 fread한 뒤 64비트 누산기(acc)에 최소 57비트를 유지
+// fp가 NULL이면 파일 대신 주어진 메모리에서 입력
+typedef struct
+{
+	FILE	*fp;
+	unsigned long long acc;	// 읽었지만 아직 소비하지 않은 비트 (하위 nbits 비트가 유효)
+	int		nbits;			// acc에 저장된 비트 수
+	const unsigned char *data;	// 입력 버퍼 (파일 입력이면 buf)
+	long	pos;			// data에서 다음에 읽을 위치
+	long	size;			// data에 저장된 바이트 수
+	unsigned char buf[BITIO_BUFSIZE];
+} BIT_READER;
+
+void bitwriter_init( BIT_WRITER *bw, FILE *fp);
+
+// capacity 바이트 크기의 메모리 mem에 출력
+void bitwriter_init_mem( BIT_WRITER *bw, unsigned char *mem, long capacity);
+
+// len 비트(len <= 56)의 코드를 상위 비트부터 출력
+void bitwriter_put( BIT_WRITER *bw, unsigned long long code, int len);
+
+// 남은 비트를 0으로 채워 바이트 단위로 출력하고 버퍼를 비움
+// return value : 지금까지 출력한 바이트 수
+long bitwriter_finish( BIT_WRITER *bw);
+
+void bitreader_init( BIT_READER *br, FILE *fp);
+
+// size 바이트 크기의 메모리 mem에서 입력
+void bitreader_init_mem( BIT_READER *br, const unsigned char *mem, long size);
+
+// acc에 57비트 이상이 남도록 채움 (입력 끝 이후는 0으로 채움)
+void bitreader_refill( BIT_READER *br);
+
+// 다음 1비트를 읽음
+int bitreader_getbit( BIT_READER *br);
+
+////////////////////////////////////////////////////////////////////////////////
+#define MAX_CODE_BITS	56	// 비트 입출력기가 한 번에 처리할 수 있는 최대 코드 길이
+#define DECODE_BITS		12	// 1차 디코딩 테이블의 인덱스 비트 수 (CODE_LEN_LIMIT 이하이면 모든 코드가 한 번에 디코딩됨)
+
+#if CODE_LEN_LIMIT < 9 || CODE_LEN_LIMIT > MAX_CODE_BITS
+#error "CODE_LEN_LIMIT must be between 9 and MAX_CODE_BITS"
+#endif
+#define DECODE_SUB_BITS	8	// 서브테이블의 최대 인덱스 비트 수
+
+// 디코딩 테이블의 엔트리
+// 다음 DECODE_BITS 비트로 1차 테이블을 찾으면 한 번에 최대 2개의 문자가 디코딩됨
+// 코드가 DECODE_BITS보다 길면 서브테이블로 연결됨
+typedef struct
+{
+	unsigned char	sym[2];	// 디코딩된 문자
+	unsigned char	count;	// sym에 저장된 문자 수 (0: 서브테이블로 연결)
+	unsigned char	len0;	// 첫 번째 문자의 코드 길이
+	unsigned char	len;	// 소비하는 전체 비트 수 (서브테이블 연결이면 이 단계에서 소비하는 비트 수)
+	unsigned char	bits;	// 연결된 서브테이블의 인덱스 비트 수
+	unsigned int	sub;	// 연결된 서브테이블의 시작 위치
+} DECODE_ENTRY;
+
+typedef struct
+{
+	DECODE_ENTRY *entries;	// 1차 테이블 (1 << DECODE_BITS 개) 뒤에 서브테이블이 이어짐
+	int		size;			// 사용 중인 엔트리 수
+	int		capacity;		// entries의 크기
+	int		max_len;		// 가장 긴 코드의 길이
+} DECODE_TABLE;
+
+// 문자별 코드(비트 값, 길이)로부터 디코딩 테이블을 생성
+// return value : 성공 1, 메모리 부족 0
+int make_decode_table( unsigned long long code_bits[], int code_len[], DECODE_TABLE *table);
+
+// 디코딩 테이블 메모리 해제
+void free_decode_table( DECODE_TABLE *table);
+
+// in의 n개 문자를 코드로 변환하여 출력
+// return value : 출력한 비트 수
+long long encode_symbols( BIT_WRITER *bw, unsigned long long code_bits[], int code_len[], const unsigned char *in, long n);
+
+// 디코딩 테이블을 이용하여 n개의 문자를 out에 디코딩
+// return value : 소비한 비트 수, 코드에 없는 비트열을 만나면 -1
+long long decode_symbols( DECODE_TABLE *table, BIT_READER *br, unsigned char *out, long n);
+
+////////////////////////////////////////////////////////////////////////////////
+#define INPUT_READ_SIZE	(1 << 20)	// mmap을 쓸 수 없을 때 read() 한 번에 읽는 바이트 수
+
+// 입력 파일
+// 일반 파일은 한 번만 mmap하여 복사 없이 사용하고, 파이프/stdin은 큰 블록 단위로 read()
+typedef struct
+{
+	int		fd;
+	const unsigned char *data;	// 입력 전체 (mmap 또는 input_load로 읽은 메모리, 아직 없으면 NULL)
+	long long	size;			// data의 크기
+	long long	pos;			// input_read로 다음에 읽을 위치
+	int		mapped;			// data가 mmap된 메모리인지 여부
+	unsigned char *owned;	// input_load가 할당한 메모리
+} INPUT;
+
+// 입력 파일 열기 (path가 "-"이면 stdin)
+// return value : 성공 1, 실패 0
+int input_open( INPUT *in, const char *path);
+
+// 최대 size 바이트를 읽고 *ptr이 읽은 내용을 가리키게 함
+// mmap된 입력은 복사 없이 매핑된 메모리를, 그 외에는 read()로 채운 buf를 가리킴
+// return value : 읽은 바이트 수 (입력 끝이면 0)
+long input_read( INPUT *in, unsigned char *buf, long size, const unsigned char **ptr);
+
+// 입력 전체를 메모리에 올리고 *data가 가리키게 함 (mmap된 입력은 그대로 사용)
+// return value : 입력의 바이트 수, 메모리 부족 -1
+long long input_load( INPUT *in, const unsigned char **data);
+
+// 입력 파일 닫기 및 메모리 해제
+void input_close( INPUT *in);
+
+////////////////////////////////////////////////////////////////////////////////
+#define FREQ_TABLES		4			// count_freq가 번갈아 사용하는 빈도표의 수
+#define PARALLEL_FREQ_MIN	(8 << 20)	// 이 크기 이상의 입력은 여러 스레드로 빈도를 계산
+// 블록 모드가 아닐 때 한 번에 인코딩할 수 있는 최대 입력 크기
+// 빈도, 원본 바이트 수 헤더 (unsigned int), 인코딩된 바이트 수가 int이므로 넘치지 않도록 제한
+#ifdef BINARY_MODE
+#define MAX_INPUT_SIZE	(INT_MAX - 1024)	// 허프만 코드의 평균 길이는 8비트 이하이므로 압축 결과는 원본 + 헤더 이하
+#else
+#define MAX_INPUT_SIZE	(INT_MAX / CODE_LEN_LIMIT)	// 텍스트 모드는 비트마다 한 문자를 출력
+#endif
+
+// 바이트 빈도 계산 커널 : data의 각 바이트 빈도를 ch_freq에 더함
+// 같은 바이트가 반복될 때 한 카운터에 대한 증가가 서로 기다리지 않도록 FREQ_TABLES개의 빈도표에 번갈아 누적한 뒤 합침
+void count_freq( const unsigned char *data, long long size, int *ch_freq);
+
+// 메모리에 올린 입력의 각 문자(바이트)의 빈도 저장
+// 입력이 PARALLEL_FREQ_MIN 이상이면 count_freq_parallel 함수 사용
+// return value : 읽은 바이트 수
+int read_chars( const unsigned char *data, long long size, int *ch_freq);
 
 // 허프만 코드에 대한 메모리 해제
 void free_huffman_code( char *codes[]);
 
-// 새로운 노드를 생성
-// 좌/우 subtree가 NULL이고 문자(data)와 빈도(freq)가 저장됨
-// return value : 노드의 포인터
-tNode *newNode(char data, int freq);
-
-// 허프만 트리를 생성
-// 1. capacity 256 짜리 빈(empty) 힙 생성
-// 2. 개별 알파벳에 대한 노드 생성
-// 3. 힙에 삽입 (minheap 구성)
-// 4. 2개의 최소값을 갖는 트리 추출
-// 5. 두 트리를 결합 후 새 노드에 추가
-// 6. 새 트리를 힙에 삽입
-// 7. 힙에 한개의 노드가 남을 때까지 반복
-// return value: 트리의 root 노드의 포인터
-tNode *make_huffman_tree( int *ch_freq);
-
-// 허프만 트리를 순회하며 허프만 코드를 생성하여 codes에 저장
-// leaf 노드에서만 코드를 생성
+// 허프만 트리를 생성 (two-queue 방식)
+// 1. 빈도가 0이 아닌 문자에 대한 leaf 노드를 빈도순으로 정렬하여 저장 (leaf 큐, 힙으로 정렬)
+// 2. leaf 큐와 내부 노드 큐의 앞에서 빈도가 가장 작은 노드 2개를 꺼냄
+// 3. 두 노드를 자식으로 하는 새 내부 노드를 내부 노드 큐의 뒤에 추가 (빈도는 항상 증가하므로 정렬이 유지됨)
+// 4. 두 큐에 한개의 노드가 남을 때까지 반복
+// return value: 트리의 root 노드의 index (빈도가 0이 아닌 문자가 없으면 -1)
+int make_huffman_tree( int *ch_freq, HUFFMAN_TREE *tree);
+
+// 허프만 트리를 순회하며 문자별 코드 길이(leaf 노드의 깊이)를 code_len에 저장
+// 부모는 자식보다 index가 크므로 root부터 index 역순으로 깊이를 전파
+// 빈도가 0인 문자는 길이 0, 문자가 하나뿐이면 길이 1
+void traverse_tree( HUFFMAN_TREE *tree, int code_len[]);
+
+// 코드 길이로부터 canonical 허프만 코드를 생성
+// 길이가 짧은 코드부터, 같은 길이에서는 문자 순서대로 연속된 값을 할당
+// return value : 성공 1, 잘못된 길이 정보(MAX_CODE_BITS 초과 또는 prefix code가 될 수 없음) 0
+int make_canonical_code( int code_len[], unsigned long long code_bits[]);
+
+// package-merge 알고리즘으로 최대 길이가 max_len 이하인 최적의 코드 길이를 계산
+// 빈도가 0인 문자는 길이 0
+void package_merge( int *ch_freq, int max_len, int code_len[]);
+
+// 코드 길이가 CODE_LEN_LIMIT을 넘으면 package_merge 함수로 코드 길이를 다시 계산
+void limit_code_len( int *ch_freq, int code_len[]);
+
+// 허프만 트리로부터 canonical 허프만 코드를 생성하여 codes에 저장
+// traverse_tree 함수로 코드 길이를 구하고 limit_code_len 함수로 길이를 제한한 뒤 make_canonical_code 함수 호출
 // strdup 함수 사용함
-void traverse_tree( tNode *root, char *code, int depth, char *codes[]);
-
-// 허프만 트리로부터 허프만 코드를 생성
-// traverse_tree 함수 호출
-void make_huffman_code( tNode *root, char *codes[]);
+void make_huffman_code( HUFFMAN_TREE *tree, int *ch_freq, char *codes[]);
 
-// 트리 메모리 해제
-void destroyTree( tNode *root);
+// 메모리에 올린 텍스트를 허프만 코드를 이용하여 바이너리 파일로 인코딩
+// return value : 인코딩된 파일의 바이트 수
+int encoding( char *codes[], const unsigned char *data, long long size, FILE *outfp);
 
-// 텍스트 파일을 허프만 코드를 이용하여 바이너리 파일로 인코딩
+// 메모리에 올린 텍스트를 허프만 코드를 이용하여 비트 단위로 압축된 바이너리 파일로 인코딩
+// 파일 형식 : [원본 바이트 수 (unsigned int)] [문자별 코드 길이 (256 바이트)]
+//             [코드 비트열 (MSB부터, 마지막 바이트는 0으로 채움)]
 // return value : 인코딩된 파일의 바이트 수
-int encoding( char *codes[], FILE *infp, FILE *outfp);
-int encoding_binary( char *codes[], FILE *infp, FILE *outfp);
+int encoding_binary( char *codes[], const unsigned char *data, long long size, FILE *outfp);
+
+// 바이너리 파일을 canonical 허프만 코드를 이용하여 텍스트 파일로 디코딩
+void decoding( char *codes[], FILE *infp, FILE *outfp);
+
+// in의 n개 문자를 코드로 변환하여 출력
+// return value : 출력한 비트 수
+long long encode_symbols( BIT_WRITER *bw, unsigned long long code_bits[], int code_len[], const unsigned char *in, long n){
+	long long bits = 0;
+
+	for(long i = 0; i < n; ++i){
+		bitwriter_put(bw, code_bits[in[i]], code_len[in[i]]);
+		bits += code_len[in[i]];
+	}
+
+	return bits;
+}
+
+// 디코딩 테이블을 이용하여 n개의 문자를 out에 디코딩
+// return value : 소비한 비트 수, 코드에 없는 비트열을 만나면 -1
+long long decode_symbols( DECODE_TABLE *table, BIT_READER *br, unsigned char *out, long n){
+	long long bits = 0;
+	long pos = 0;
+
+	while(pos < n){
+		if(br->nbits < table->max_len || br->nbits < DECODE_BITS)
+			bitreader_refill(br);
+
+		DECODE_ENTRY *e = &table->entries[(br->acc >> (br->nbits - DECODE_BITS)) & ((1 << DECODE_BITS) - 1)];
+		while(e->count == 0 && e->bits > 0){
+			br->nbits -= e->len;
+			bits += e->len;
+			e = &table->entries[e->sub + ((br->acc >> (br->nbits - e->bits)) & ((1 << e->bits) - 1))];
+		}
+
+		if(e->count == 0) // 코드에 없는 비트열
+			return -1;
 
-// 바이너리 파일을 허프만 트리를 이용하여 텍스트 파일로 디코딩
-void decoding( tNode *root, FILE *infp, FILE *outfp);
-void decoding_binary( tNode *root, FILE *infp, FILE *outfp);
+		if(e->count == 2 && pos + 1 < n){
+			out[pos++] = e->sym[0];
+			out[pos++] = e->sym[1];
+			br->nbits -= e->len;
+			bits += e->len;
+		}
+		else{
+			out[pos++] = e->sym[0];
+			br->nbits -= e->len0;
+			bits += e->len0;
+		}
+	}
+
+	return bits;
+}
+
+// 비트 단위로 압축된 바이너리 파일을 텍스트 파일로 디코딩
+// 헤더의 코드 길이로 canonical 코드와 디코딩 테이블을 만든 뒤 테이블 참조로 디코딩
+// 허프만 트리나 빈도 정보 없이 파일만으로 디코딩 가능
+void decoding_binary( FILE *infp, FILE *outfp);
+
+////////////////////////////////////////////////////////////////////////////////
+#define BLOCK_SIZE		(1 << 20)	// 블록 모드에서 한 블록의 원본 바이트 수
+#define MAX_THREADS		64
+#define BLOCK_MAGIC		"HUFB"
+
+// 스레드 풀
+// pool_run으로 주어진 작업(0 ~ num_jobs-1)을 작업 스레드들이 나누어 처리
+typedef struct
+{
+	pthread_mutex_t	lock;
+	pthread_cond_t	work_cv;	// 새 작업이 주어졌거나 종료 요청
+	pthread_cond_t	done_cv;	// 모든 작업 완료
+	void	(*fn)( void *arg, int job);
+	void	*arg;
+	int		next_job;		// 다음에 처리할 작업 번호
+	int		num_jobs;
+	int		done_jobs;		// 완료된 작업 수
+	int		quit;
+	int		num_threads;
+	pthread_t threads[MAX_THREADS];
+} THREAD_POOL;
+
+#define BLOCK_HUFFMAN	0	// [문자별 코드 길이 (256 바이트)] [코드 비트열]
+#define BLOCK_STORED	1	// [원본]
+#define BLOCK_RLE		2	// [(문자, 반복 횟수 - 1) 바이트 쌍]*
+#define BLOCK_HUFFMAN4	3	// [문자별 코드 길이 (256 바이트)] [점프 테이블 (비트열 0~2의 크기, unsigned int 3개)] [비트열 0] ... [비트열 3]
+
+#define NUM_STREAMS		4	// BLOCK_HUFFMAN4의 비트열 수, 블록을 NUM_STREAMS개의 연속 구간으로 나누어 구간마다 비트열 하나로 인코딩
+#define STREAMS_MIN_SIZE	(16 << 10)	// 이보다 작은 블록은 점프 테이블 비용에 비해 이득이 적으므로 BLOCK_HUFFMAN으로 인코딩
+
+#define BLOCK_ORDER1	4	// [테이블 수 (1 바이트)] [문맥(이전 문자)별 테이블 번호 (256 바이트)] [테이블별 코드 길이 (256 바이트씩)]
+							// [점프 테이블 (비트열 0~2의 크기, unsigned int 3개)] [비트열 0] ... [비트열 3]
+#define MAX_CONTEXT_TABLES	8	// BLOCK_ORDER1의 최대 테이블 수, 256개의 문맥별 빈도를 이 수 이하의 테이블로 묶음
+#define ORDER1_MIN_SIZE	(16 << 10)	// 이보다 작은 블록은 테이블 비용이 커서 order-1 모델을 고려하지 않음
+#define ORDER1_MIN_GAIN	16	// 문맥으로 얻는 엔트로피 이득이 문자당 1/ORDER1_MIN_GAIN 비트보다 작으면 order-1 모델을 만들지 않음
+#define CLUSTER_ITERATIONS	4	// 문맥을 테이블로 묶을 때 재배정을 반복하는 최대 횟수
+
+// BLOCK_ORDER1의 모델
+// 블록을 BLOCK_HUFFMAN4처럼 NUM_STREAMS개의 구간으로 나누어 비트열마다 인코딩하며, 각 구간 첫 문자의 문맥은 0
+// 다음 문자의 테이블이 이전 문자에 의존하므로 비트열을 번갈아 디코딩해야 의존성이 끊김
+typedef struct
+{
+	int		num_tables;
+	unsigned char	ctx_map[256];	// 이전 문자별 테이블 번호
+	int		code_len[MAX_CONTEXT_TABLES][256];	// 테이블별 코드 길이
+	long long	size;			// BLOCK_ORDER1로 인코딩했을 때의 블록 크기
+	long long	stream_bytes[NUM_STREAMS];	// 비트열별 바이트 수
+} ORDER1_MODEL;
+
+// 블록 하나의 원본과 압축 결과
+// 압축된 블록 형식 : [블록 종류 (1 바이트, BLOCK_HUFFMAN/BLOCK_STORED/BLOCK_RLE/BLOCK_HUFFMAN4/BLOCK_ORDER1)] [종류별 내용]
+// 블록마다 세 종류의 압축 크기를 추정하여 가장 작은 것을 선택하므로 압축 결과는 원본 + 1 바이트를 넘지 않음
+typedef struct
+{
+	unsigned char	*raw;	// 원본
+	int		raw_size;
+	unsigned char	*comp;	// 압축 결과
+	int		comp_size;
+	int		error;			// 디코딩 중 잘못된 입력 발견
+} BLOCK;
+
+// num_threads개의 작업 스레드 생성
+// return value : 성공 1, 실패 0
+int pool_create( THREAD_POOL *pool, int num_threads);
+
+// fn( arg, 0) ~ fn( arg, num_jobs-1)을 작업 스레드들이 나누어 수행하고 모두 끝날 때까지 대기
+void pool_run( THREAD_POOL *pool, void (*fn)( void *arg, int job), void *arg, int num_jobs);
+
+// 작업 스레드 종료 및 자원 해제
+void pool_destroy( THREAD_POOL *pool);
+
+// data를 작업 스레드 수만큼 나누어 스레드별로 count_freq를 수행한 뒤 빈도를 합침
+void count_freq_parallel( THREAD_POOL *pool, const unsigned char *data, long long size, int *ch_freq);
+
+// 입력을 BLOCK_SIZE 단위의 독립된 블록으로 나누어 스레드 풀에서 병렬로 인코딩
+// mmap된 입력은 매핑된 메모리를 복사 없이 블록으로 사용
+// 파일 형식 : [BLOCK_MAGIC] [블록 크기 (unsigned int)] [블록 0] [블록 1] ...
+//             [블록별 (원본 크기, 압축 크기) (unsigned int 2개) 인덱스] [블록 수 (unsigned int)] [BLOCK_MAGIC]
+// num_bytes : 입력의 바이트 수를 저장
+// return value : 인코딩된 파일의 바이트 수, 실패 -1
+long long block_encoding( INPUT *in, FILE *outfp, long long *num_bytes);
+
+// 블록 인덱스를 읽고 블록들을 스레드 풀에서 병렬로 디코딩
+// return value : 성공 1, 실패 0
+int block_decoding( FILE *infp, FILE *outfp);
+
+////////////////////////////////////////////////////////////////////////////////
+#define STREAM_MAGIC	"HUFS"
+#define STREAM_BLOCK_HEADER	8	// 블록 헤더 : [원본 크기 (unsigned int)] [압축 크기 (unsigned int)]
+
+// 압축된 블록의 최대 크기 (BLOCK_STORED)
+#define MAX_COMP_BLOCK	(1 + BLOCK_SIZE)
+
+// 스트리밍 인코더
+// 입력을 조금씩 받아 BLOCK_SIZE가 찰 때마다 블록 하나를 인코딩하여 출력 (메모리 사용량은 블록 하나로 제한됨)
+// 스트림 형식 : [STREAM_MAGIC] {[블록 헤더] [압축된 블록]}* [원본 크기 0인 블록 헤더]
+typedef struct
+{
+	FILE	*outfp;
+	unsigned char	*buf;	// 아직 인코딩하지 않은 입력 (BLOCK_SIZE)
+	int		size;			// buf에 저장된 바이트 수
+	long long	in_bytes;	// 입력받은 전체 바이트 수
+	long long	out_bytes;	// 출력한 전체 바이트 수
+	int		error;
+} HUFF_ENCODER;
+
+// 스트리밍 디코더
+// 압축된 스트림을 임의의 크기로 나누어 받아 블록이 완성될 때마다 디코딩하여 출력
+typedef struct
+{
+	FILE	*outfp;
+	int		state;			// 0: STREAM_MAGIC, 1: 블록 헤더, 2: 압축된 블록, 3: 스트림 끝
+	unsigned char	header[STREAM_BLOCK_HEADER];
+	int		header_size;	// header에 저장된 바이트 수
+	BLOCK	block;			// 현재 블록 (comp : 압축된 블록을 모으는 버퍼, raw : 디코딩 결과)
+	int		comp_filled;	// block.comp에 저장된 바이트 수
+	long long	out_bytes;	// 출력한 전체 바이트 수
+	int		error;
+} HUFF_DECODER;
+
+// 인코더 초기화 및 STREAM_MAGIC 출력
+// return value : 성공 1, 메모리 부족 0
+int huff_encoder_init( HUFF_ENCODER *enc, FILE *outfp);
+
+// size 바이트의 입력 추가, 블록이 찰 때마다 인코딩하여 출력
+// return value : 성공 1, 실패 0
+int huff_encoder_update( HUFF_ENCODER *enc, const unsigned char *data, long size);
+
+// 남은 입력을 마지막 블록으로 출력하고 스트림 끝 표시 후 메모리 해제
+// return value : 성공 1, 실패 0
+int huff_encoder_finish( HUFF_ENCODER *enc);
+
+// 디코더 초기화
+// return value : 성공 1, 메모리 부족 0
+int huff_decoder_init( HUFF_DECODER *dec, FILE *outfp);
+
+// 압축된 스트림 size 바이트 추가, 블록이 완성될 때마다 디코딩하여 출력
+// return value : 성공 1, 잘못된 입력 0
+int huff_decoder_update( HUFF_DECODER *dec, const unsigned char *data, long size);
+
+// 메모리 해제
+// return value : 스트림 끝까지 올바르게 디코딩했으면 1, 아니면 0
+int huff_decoder_finish( HUFF_DECODER *dec);
+
+// infp를 끝까지 읽으며 스트리밍 인코더로 압축하여 outfp에 출력 (파이프/stdin 사용 가능)
+// return value : 성공 1, 실패 0
+int stream_encoding( FILE *infp, FILE *outfp);
+
+// infp를 끝까지 읽으며 스트리밍 디코더로 해제하여 outfp에 출력 (파이프/stdin 사용 가능)
+// return value : 성공 1, 실패 0
+int stream_decoding( FILE *infp, FILE *outfp);
+
+////////////////////////////////////////////////////////////////////////////////
+#define BENCH_REPEAT	3	// 코퍼스마다 인코딩/디코딩을 반복하는 횟수 (가장 빠른 결과를 출력)
+
+// 벤치마크 코퍼스 종류
+#define CORPUS_UNIFORM	0	// 균등 분포 임의 바이트
+#define CORPUS_ZIPF		1	// Zipf 분포 바이트 (순위 r의 확률이 1/r에 비례)
+#define CORPUS_TEXT		2	// 영어 단어를 Zipf 분포로 나열한 텍스트
+#define CORPUS_RUNS		3	// 긴 반복 구간과 짧은 임의 구간이 섞인 바이너리
+#define NUM_CORPORA		4
+
+// kind 종류의 코퍼스 size 바이트를 data에 생성 (seed가 같으면 항상 같은 내용)
+void make_corpus( int kind, unsigned char *data, long size, unsigned long long seed);
+
+// 생성한 코퍼스를 크기별로 메모리에서 블록 인코딩/디코딩하여 결과를 TSV로 outfp에 출력
+// 열 : 코퍼스, 크기, 스레드 수, 압축 크기, 압축률, 인코딩/디코딩 MB/s, 인코딩/디코딩 바이트당 사이클, 최대 RSS (KB)
+// 최대 RSS는 줄마다 되돌린 뒤의 최고치 (/proc/self/clear_refs를 쓸 수 없으면 프로세스 전체의 최고치이며 주석 줄에 rss=cumulative로 표시)
+// 바이트당 사이클은 TSC로 잰 경과 사이클 기준 (TSC가 없으면 nan)
+// return value : 모든 코퍼스가 올바르게 복원되면 1, 아니면 0
+int run_benchmark( FILE *outfp, const long *sizes, int num_sizes, int num_threads);
 
 ////////////////////////////////////////////////////////////////////////////////
 // 문자별 빈도 출력 (for debugging)
@@ -106,14 +542,12 @@ void print_char_freq( int *ch_freq){
 
 ////////////////////////////////////////////////////////////////////////////////
 // 문자별 빈도를 이용하여 허프만 트리와 허프만 코드를 생성
-// return value : 허프만 트리의 root node
-tNode *run_huffman( int *ch_freq, char *codes[]){
-	tNode *root;
-	root = make_huffman_tree( ch_freq);
-	
-	make_huffman_code( root, codes);
+void run_huffman( int *ch_freq, char *codes[]){
+	HUFFMAN_TREE tree;
+
+	make_huffman_tree( ch_freq, &tree);
 	
-	return root;
+	make_huffman_code( &tree, ch_freq, codes);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -122,48 +556,169 @@ void print_huffman_code( char *codes[]){
 	int i;
 	
 	for (i = 0; i < 256; i++)
-		printf( "%d\t%s\n", i, codes[i]);
+		printf( "%d\t%s\n", i, (codes[i] != NULL) ? codes[i] : "");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // argv[1] : 입력 텍스트 파일
 // argv[2] : 바이너리 코드 (encoding 결과) 
 // argv[3] : 출력 텍스트 파일 (decoding 결과)
+// 디코딩만 하는 경우 (BINARY_MODE) : argv[1] = "-d", argv[2] : 바이너리 코드, argv[3] : 출력 텍스트 파일
 int main( int argc, char **argv){
-	FILE *fp;
+	INPUT in; // 입력 텍스트 파일 (한 번만 열어 메모리에 올림)
+	const unsigned char *data;
 	FILE *infp, *outfp;
 	int ch_freq[256] = {0,}; // 문자별 빈도
 	char *codes[256]; // 문자별 허프만 코드 (ragged 배열)
-	tNode *huffman_tree; // 허프만 트리
 	
+#ifdef BINARY_MODE
+	// stdin을 압축(-c) 또는 해제(-x)하여 stdout으로 출력
+	if (argc == 2 && strcmp( argv[1], "-c") == 0)
+		return stream_encoding( stdin, stdout) ? 0 : 1;
+	if (argc == 2 && strcmp( argv[1], "-x") == 0)
+		return stream_decoding( stdin, stdout) ? 0 : 1;
+
+	// 생성한 코퍼스로 벤치마크 (크기를 주지 않으면 64K, 1M, 16M)
+	if (argc >= 2 && strcmp( argv[1], "-b") == 0){
+		long sizes[16] = { 64 << 10, 1 << 20, 16 << 20};
+		int num_sizes = 3;
+
+		if (argc > 2){
+			num_sizes = 0;
+			for (int i = 2; i < argc && num_sizes < 16; i++){
+				char *end;
+				long size = strtol( argv[i], &end, 10);
+
+				if (*end == 'K' || *end == 'k') size <<= 10;
+				else if (*end == 'M' || *end == 'm') size <<= 20;
+				if (size <= 0){
+					fprintf( stderr, "Error : invalid size [%s]\n", argv[i]);
+					return 1;
+				}
+				sizes[num_sizes++] = size;
+			}
+		}
+		return run_benchmark( stdout, sizes, num_sizes, (int)sysconf(_SC_NPROCESSORS_ONLN)) ? 0 : 1;
+	}
+#endif
+
 	if (argc != 4){
 		fprintf( stderr, "%s input-file encoded-file decoded-file\n", argv[0]);
+#ifdef BINARY_MODE
+		fprintf( stderr, "%s -d encoded-file decoded-file\n", argv[0]);
+		fprintf( stderr, "%s -c|-x < input > output\n", argv[0]);
+		fprintf( stderr, "%s -b [size[K|M] ...]\n", argv[0]);
+#endif
+		return 1;
+	}
+
+#ifdef BINARY_MODE
+	// 인코딩된 파일의 헤더(코드 길이)만으로 디코딩
+	if (strcmp( argv[1], "-d") == 0){
+		infp = fopen( argv[2], "rb");
+		if (infp == NULL){
+			fprintf( stderr, "Error: cannot open file [%s]\n", argv[2]);
+			return 1;
+		}
+		outfp = fopen( argv[3], "wb");
+		if (outfp == NULL){
+			fprintf( stderr, "Error: cannot open file [%s]\n", argv[3]);
+			fclose( infp);
+			return 1;
+		}
+
+#ifdef BLOCK_MODE
+		int ok = block_decoding( infp, outfp);
+#else
+		decoding_binary( infp, outfp);
+		int ok = 1;
+#endif
+
+		fclose( infp);
+		fclose( outfp);
+		return ok ? 0 : 1;
+	}
+#endif
+
+#if defined(BINARY_MODE) && defined(BLOCK_MODE)
+	////////////////////////////////////////
+	// 블록 단위 병렬 인코딩 (블록마다 별도의 허프만 코드 사용)
+	if (!input_open( &in, argv[1])){
+		fprintf( stderr, "Error: cannot open file [%s]\n", argv[1]);
+		return 1;
+	}
+	outfp = fopen( argv[2], "wb");
+	if (outfp == NULL){
+		fprintf( stderr, "Error: cannot open file [%s]\n", argv[2]);
+		input_close( &in);
+		return 1;
+	}
+
+	long long total_bytes;
+	long long block_bytes = block_encoding( &in, outfp, &total_bytes);
+
+	input_close( &in);
+	fclose( outfp);
+
+	if (block_bytes < 0){
+		fprintf( stderr, "Error : encoding failed!\n");
+		return 1;
+	}
+
+	// 블록 단위 병렬 디코딩
+	infp = fopen( argv[2], "rb");
+	if (infp == NULL){
+		fprintf( stderr, "Error: cannot open file [%s]\n", argv[2]);
+		return 1;
+	}
+	outfp = fopen( argv[3], "wb");
+	if (outfp == NULL){
+		fprintf( stderr, "Error: cannot open file [%s]\n", argv[3]);
+		fclose( infp);
+		return 1;
+	}
+
+	int ok = block_decoding( infp, outfp);
+
+	fclose( infp);
+	fclose( outfp);
+
+	if (!ok){
+		fprintf( stderr, "Error : decoding failed!\n");
 		return 1;
 	}
 
+	printf( "# of bytes of the original text = %lld\n", total_bytes);
+	printf( "# of bytes of the compressed text = %lld\n", block_bytes);
+	// 빈 입력이면 압축률 0
+	printf( "compression ratio = %.2f\n", (total_bytes > 0) ? ((float)total_bytes - block_bytes) / total_bytes * 100 : 0.0);
+
+	return 0;
+#endif
+
 	////////////////////////////////////////
 	// 입력 텍스트 파일
-	fp = fopen( argv[1], "rt");
-	if (fp == NULL){
+	if (!input_open( &in, argv[1]) || input_load( &in, &data) < 0){
 		fprintf( stderr, "Error: cannot open file [%s]\n", argv[1]);
 		return 1;
 	}
+	if (in.size > MAX_INPUT_SIZE){
+		fprintf( stderr, "Error: input is too large (%lld bytes, at most %d without block mode)\n", in.size, MAX_INPUT_SIZE);
+		input_close( &in);
+		return 1;
+	}
 
 	// 텍스트 파일로부터 문자별 빈도 저장
-	int num_bytes = read_chars( fp, ch_freq);
+	int num_bytes = read_chars( data, in.size, ch_freq);
 
-	fclose( fp);
 	// 문자별 빈도 출력 (for debugging)
 	//print_char_freq( ch_freq);
 	// 허프만 코드/트리 생성
-	huffman_tree = run_huffman( ch_freq, codes);
+	run_huffman( ch_freq, codes);
 	// 허프만 코드 출력 (stdout)
 	print_huffman_code( codes);
 
 	////////////////////////////////////////
-	// 입력: 텍스트 파일
-	infp = fopen( argv[1], "rt");
-	
 #ifdef BINARY_MODE
 	// 출력: 바이너리 코드
 	outfp = fopen( argv[2], "wb");
@@ -174,15 +729,12 @@ int main( int argc, char **argv){
 
 	// 허프만코드를 이용하여 인코딩(압축)
 #ifdef BINARY_MODE
-	int encoded_bytes = encoding_binary( codes, infp, outfp);
+	int encoded_bytes = encoding_binary( codes, data, in.size, outfp);
 #else
-	int encoded_bytes = encoding( codes, infp, outfp);
+	int encoded_bytes = encoding( codes, data, in.size, outfp);
 #endif
 
-	// 허프만 코드 메모리 해제
-	free_huffman_code( codes);
-	
-	fclose( infp);
+	input_close( &in);
 	fclose( outfp);
 
 	////////////////////////////////////////
@@ -196,15 +748,15 @@ int main( int argc, char **argv){
 	// 출력: 텍스트 파일
 	outfp = fopen( argv[3], "wt");
 
-	// 허프만 트리를 이용하여 디코딩
+	// 디코딩
 #ifdef BINARY_MODE
-	decoding_binary( huffman_tree, infp, outfp);
+	decoding_binary( infp, outfp);
 #else
-	decoding( huffman_tree, infp, outfp);
+	decoding( codes, infp, outfp);
 #endif
 
-	// 허프만 트리 메모리 해제
-	destroyTree( huffman_tree);
+	// 허프만 코드 메모리 해제
+	free_huffman_code( codes);
 
 	fclose( infp);
 	fclose( outfp);
@@ -221,15 +773,28 @@ int main( int argc, char **argv){
 // 힙의 내용 출력 (for debugging)
 void heapPrint( HEAP *heap){
 	int i;
-	tNode **p = heap->heapArr;
+	HEAP_ENTRY *p = heap->heapArr;
 	int last = heap->last;
 	
 	for( i = 0; i <= last; i++){
-		printf("[%d]%c(%6d)\n", i, p[i]->data, p[i]->freq);
+		printf("[%d]%d(%6lld)\n", i, p[i].item, p[i].key);
 	}
 	printf( "\n");
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 호출한 쪽의 메모리로 빈 힙 초기화
+void heapInit( HEAP *heap, HEAP_ENTRY *arr, int *pos, int capacity){
+	heap->last = -1;
+	heap->capacity = capacity;
+	heap->heapArr = arr;
+	heap->pos = pos;
+	heap->owned = 0;
+
+	for (int i = 0; i < capacity; i++)
+		pos[i] = -1;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // 힙 생성
 // 배열을 위한 메모리 할당 (capacity)
@@ -240,49 +805,52 @@ HEAP *heapCreate( int capacity){
 	heap = (HEAP *)malloc( sizeof(HEAP));
 	if (!heap) return NULL;
 
-	heap->last = -1;
-	heap->capacity = capacity;
-	heap->heapArr = (tNode **)malloc( sizeof(tNode *) * capacity);
-	if (heap->heapArr == NULL){
+	HEAP_ENTRY *arr = (HEAP_ENTRY *)malloc( sizeof(HEAP_ENTRY) * capacity);
+	int *pos = (int *)malloc( sizeof(int) * capacity);
+	if (arr == NULL || pos == NULL){
 		fprintf( stderr, "Error : not enough memory!\n");
+		free( arr);
+		free( pos);
 		free( heap);
 		return NULL;
 	}
+
+	heapInit( heap, arr, pos, capacity);
+	heap->owned = 1;
 	return heap;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // 최소힙 유지
+// 옮길 원소를 들고 있다가 빈 자리에 한 번만 기록 (교환 대신 이동)
 static void _reheapUp( HEAP *heap, int index){
-	tNode **arr = heap->heapArr;
-	int parent;
+	HEAP_ENTRY *arr = heap->heapArr;
+	HEAP_ENTRY e = arr[index];
 	
-	while(1){
-		if (index == 0) return; // root node
-		
-		parent = (index - 1) / 2;
+	while (index > 0){
+		int parent = (index - 1) / HEAP_D;
 		
-		if (arr[index]->freq < arr[parent]->freq) // exchange (for minheap)
-		{
-			tNode *temp = arr[index];
-			arr[index] = arr[parent];
-			arr[parent] = temp;
-			
-			index = parent;
-		}
-		else return;
+		if (e.key >= arr[parent].key) break;
+
+		arr[index] = arr[parent];
+		heap->pos[arr[index].item] = index;
+		index = parent;
 	}
+
+	arr[index] = e;
+	heap->pos[e.item] = index;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // 힙에 원소 삽입
 // _reheapUp 함수 호출
-int heapInsert( HEAP *heap, tNode *data){
-	if (heap->last == heap->capacity - 1)
+int heapInsert( HEAP *heap, int item, long long key){
+	if (heap->last == heap->capacity - 1 || item < 0 || item >= heap->capacity || heap->pos[item] >= 0)
 		return 0;
 	
 	(heap->last)++;
-	(heap->heapArr)[heap->last] = data;
+	heap->heapArr[heap->last].key = key;
+	heap->heapArr[heap->last].item = item;
 	
 	_reheapUp( heap, heap->last);
 	
@@ -291,266 +859,2491 @@ int heapInsert( HEAP *heap, tNode *data){
 
 ////////////////////////////////////////////////////////////////////////////////
 // 최소힙 유지
+// HEAP_D개의 자식 중 키가 가장 작은 자식과 비교하며 내려감
 static void _reheapDown( HEAP *heap, int index){
-	tNode **arr = heap->heapArr;
-	tNode *leftData;
-	tNode *rightData;
-	int noright = 0;
-	int largeindex; // index of left or right child with large key
+	HEAP_ENTRY *arr = heap->heapArr;
+	HEAP_ENTRY e = arr[index];
+	int last = heap->last;
 	
-	while(1){
-		if ((index * 2 + 1) > heap->last) return; // leaf node (there is no left subtree)
-		
-		leftData = arr[index * 2 + 1];
-		if (index * 2 + 2 <= heap->last) rightData = arr[index * 2 + 2];
-		else noright = 1;
+	while (1){
+		int first = index * HEAP_D + 1;
+		if (first > last) break; // leaf node
+
+		int end = (first + HEAP_D - 1 < last) ? first + HEAP_D - 1 : last;
+		int smallindex = first; // index of the child with the smallest key
+		for (int c = first + 1; c <= end; c++)
+			if (arr[c].key < arr[smallindex].key) smallindex = c;
 		
-		if (noright || leftData->freq < rightData->freq) largeindex = index * 2 + 1; // left child
-		else largeindex = index * 2 + 2; // right child
-		
-		if (arr[index]->freq > arr[largeindex]->freq) // exchange (for minheap)
-		{
-			tNode *temp = arr[index];
-			arr[index] = arr[largeindex];
-			arr[largeindex] = temp;
-			
-			index = largeindex;
-			
-			noright = 0;
-		}
-		else return;
+		if (arr[smallindex].key >= e.key) break;
+
+		arr[index] = arr[smallindex];
+		heap->pos[arr[index].item] = index;
+		index = smallindex;
 	}
+
+	arr[index] = e;
+	heap->pos[e.item] = index;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // 최소값 제거
 // _reheapDown 함수 호출
-tNode *heapDelete( HEAP *heap){
-	if (heap->last == -1) return NULL; // empty heap
+int heapDelete( HEAP *heap, long long *key){
+	if (heap->last == -1) return -1; // empty heap
 	
-	tNode *data = heap->heapArr[0];
+	HEAP_ENTRY top = heap->heapArr[0];
+	if (key != NULL) *key = top.key;
+	heap->pos[top.item] = -1;
+
 	heap->heapArr[0] = heap->heapArr[heap->last];
-	
 	(heap->last)--;
 	
-	_reheapDown( heap, 0);
+	if (heap->last >= 0)
+		_reheapDown( heap, 0);
 	
-	return data;
+	return top.item;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 원소들을 한 번에 넣고 마지막 내부 노드부터 root까지 _reheapDown (O(n))
+int heapBuild( HEAP *heap, const int *items, const long long *keys, int n){
+	if (n > heap->capacity) return 0;
+
+	for (int i = 0; i <= heap->last; i++)
+		heap->pos[heap->heapArr[i].item] = -1;
+
+	for (int i = 0; i < n; i++){
+		heap->heapArr[i].key = keys[i];
+		heap->heapArr[i].item = items[i];
+		heap->pos[items[i]] = i;
+	}
+	heap->last = n - 1;
+
+	for (int i = (n - 2) / HEAP_D; i >= 0 && n > 1; i--)
+		_reheapDown( heap, i);
+
+	return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 키를 줄이면 부모 쪽으로만 움직임
+int heapDecreaseKey( HEAP *heap, int item, long long key){
+	if (item < 0 || item >= heap->capacity) return 0;
+
+	int index = heap->pos[item];
+	if (index < 0 || key > heap->heapArr[index].key) return 0;
+
+	heap->heapArr[index].key = key;
+	_reheapUp( heap, index);
+
+	return 1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // 힙 메모리 해제
 void heapDestroy( HEAP *heap){
+	if (!heap->owned) return;
+
 	free(heap->heapArr);
+	free(heap->pos);
 	free(heap);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// 파일에 속한 각 문자(바이트)의 빈도 저장
-// return value : 파일에서 읽은 바이트 수
-int read_chars( FILE *fp, int *ch_freq){
-	int c, bytes = 0;
-
-	while((c = fgetc(fp)) != EOF){
-		ch_freq[c]++;
-		bytes++;
+// 입력 파일 열기 (path가 "-"이면 stdin)
+// return value : 성공 1, 실패 0
+int input_open( INPUT *in, const char *path){
+	struct stat st;
+
+	in->fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY);
+	in->data = NULL;
+	in->size = 0;
+	in->pos = 0;
+	in->mapped = 0;
+	in->owned = NULL;
+
+	if(in->fd < 0) return 0;
+
+	// 크기가 0인 파일은 mmap할 수 없으므로 read() 경로를 사용
+	if(fstat(in->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+		void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, in->fd, 0);
+		if(p != MAP_FAILED){
+			madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+			in->data = (const unsigned char *)p;
+			in->size = (long long)st.st_size;
+			in->mapped = 1;
+		}
 	}
 
-	return bytes;
-}
-
-// 허프만 코드에 대한 메모리 해제
-void free_huffman_code( char *codes[]){
-	for(int i = 0; i < 256; ++i)
-		if(codes[i] != NULL)
-			free(codes[i]);
+	return 1;
 }
 
-// 새로운 노드를 생성
-// 좌/우 subtree가 NULL이고 문자(data)와 빈도(freq)가 저장됨
-// return value : 노드의 포인터
-tNode *newNode(char data, int freq){
-	tNode* newN = (tNode*)malloc(sizeof(tNode));
+// read()가 요청보다 적게 읽는 경우에도 size 바이트를 채울 때까지 읽음
+// return value : 읽은 바이트 수 (입력 끝이면 size보다 작음)
+static long _read_fd( int fd, unsigned char *buf, long size){
+	long total = 0;
 
-	newN->data = data;
-	newN->freq = freq;
-	newN->left = NULL;
-	newN->right = NULL;
+	while(total < size){
+		ssize_t n = read(fd, buf + total, (size_t)(size - total));
+		if(n <= 0) break;
+		total += (long)n;
+	}
 
-	return newN;
+	return total;
 }
 
-// 허프만 트리를 생성
-// 1. capacity 256 짜리 빈(empty) 힙 생성
-// 2. 개별 알파벳에 대한 노드 생성
-// 3. 힙에 삽입 (minheap 구성)
-// 4. 2개의 최소값을 갖는 트리 추출
-// 5. 두 트리를 결합 후 새 노드에 추가
-// 6. 새 트리를 힙에 삽입
-// 7. 힙에 한개의 노드가 남을 때까지 반복
-// return value: 트리의 root 노드의 포인터
-tNode *make_huffman_tree( int *ch_freq){
-	HEAP* Heap = heapCreate(256);
-	tNode* NewNode;
+// 최대 size 바이트를 읽고 *ptr이 읽은 내용을 가리키게 함
+// mmap된 입력은 복사 없이 매핑된 메모리를, 그 외에는 read()로 채운 buf를 가리킴
+// return value : 읽은 바이트 수 (입력 끝이면 0)
+long input_read( INPUT *in, unsigned char *buf, long size, const unsigned char **ptr){
+	if(in->data != NULL){
+		long n = (in->size - in->pos < size) ? (long)(in->size - in->pos) : size;
 
-	for (int i = 0; i < 256; ++i) { // 수정
-		char c = (char)(i - 128);
-		NewNode = newNode(c, ch_freq[i]);
-		heapInsert(Heap, NewNode);
+		*ptr = in->data + in->pos;
+		in->pos += n;
+		return n;
 	}
 
-	while(Heap->last){
-		tNode* min_fst = heapDelete(Heap);
-		tNode* min_sec = heapDelete(Heap);
-		int freq = (min_fst->freq) + (min_sec->freq);
+	*ptr = buf;
+	return _read_fd(in->fd, buf, size);
+}
 
-		NewNode = newNode('\0', freq);
-		NewNode->left = min_fst;
-		NewNode->right = min_sec;
+// 입력 전체를 메모리에 올리고 *data가 가리키게 함 (mmap된 입력은 그대로 사용)
+// return value : 입력의 바이트 수, 메모리 부족 -1
+long long input_load( INPUT *in, const unsigned char **data){
+	if(in->data == NULL){
+		long long capacity = 0, size = 0;
+
+		while(1){
+			if(size + INPUT_READ_SIZE > capacity){
+				capacity = (capacity == 0) ? INPUT_READ_SIZE : capacity * 2;
+				unsigned char *p = (unsigned char *)realloc(in->owned, (size_t)capacity);
+				if(p == NULL) return -1;
+				in->owned = p;
+			}
+
+			long n = _read_fd(in->fd, in->owned + size, INPUT_READ_SIZE);
+			size += n;
+			if(n < INPUT_READ_SIZE) break;
+		}
 
-		heapInsert(Heap, NewNode);
+		in->data = in->owned;
+		in->size = size;
+		in->pos = 0;
 	}
 
-	tNode* root = heapDelete(Heap);
-	heapDestroy(Heap);
+	*data = in->data;
+	return in->size;
+}
+
+// 입력 파일 닫기 및 메모리 해제
+void input_close( INPUT *in){
+	if(in->mapped) munmap((void *)in->data, (size_t)in->size);
+	free(in->owned);
+	if(in->fd > STDIN_FILENO) close(in->fd);
 
-	return root;
+	in->data = NULL;
+	in->owned = NULL;
 }
 
-// 허프만 트리를 순회하며 허프만 코드를 생성하여 codes에 저장
-// leaf 노드에서만 코드를 생성
-// strdup 함수 사용함
-void traverse_tree( tNode *root, char *code, int depth, char *codes[]){
-	if((root->left == NULL) && (root->right == NULL)){
-		char c = root->data;
-		int num = (int)c + 128;
-		codes[num] = strdup(code);
-		return;
-	}
+// 바이트 빈도 계산 커널 : data의 각 바이트 빈도를 ch_freq에 더함
+// 같은 바이트가 반복될 때 한 카운터에 대한 증가가 서로 기다리지 않도록 FREQ_TABLES개의 빈도표에 번갈아 누적한 뒤 합침
+void count_freq( const unsigned char *data, long long size, int *ch_freq){
+	unsigned int cnt[FREQ_TABLES][256];
+
+	while(size > 0){
+		// 빈도표의 카운터가 넘치지 않도록 1GiB씩 나누어 계산
+		long long n = (size < (1LL << 30)) ? size : (1LL << 30);
+		long long i = 0;
+
+		memset(cnt, 0, sizeof(cnt));
+
+		for(; i + 16 <= n; i += 16){
+			unsigned long long a, b;
+			memcpy(&a, data + i, 8);
+			memcpy(&b, data + i + 8, 8);
+
+			cnt[0][a & 0xff]++;
+			cnt[1][(a >> 8) & 0xff]++;
+			cnt[2][(a >> 16) & 0xff]++;
+			cnt[3][(a >> 24) & 0xff]++;
+			cnt[0][(a >> 32) & 0xff]++;
+			cnt[1][(a >> 40) & 0xff]++;
+			cnt[2][(a >> 48) & 0xff]++;
+			cnt[3][a >> 56]++;
+
+			cnt[0][b & 0xff]++;
+			cnt[1][(b >> 8) & 0xff]++;
+			cnt[2][(b >> 16) & 0xff]++;
+			cnt[3][(b >> 24) & 0xff]++;
+			cnt[0][(b >> 32) & 0xff]++;
+			cnt[1][(b >> 40) & 0xff]++;
+			cnt[2][(b >> 48) & 0xff]++;
+			cnt[3][b >> 56]++;
+		}
+		for(; i < n; ++i)
+			cnt[0][data[i]]++;
+
+		for(int c = 0; c < 256; ++c)
+			ch_freq[c] += (int)(cnt[0][c] + cnt[1][c] + cnt[2][c] + cnt[3][c]);
 
-	if(root->left){
-		code[depth] = '0';
-		traverse_tree(root->left, code, depth+1, codes);
+		data += n;
+		size -= n;
 	}
+}
+
+// 메모리에 올린 입력의 각 문자(바이트)의 빈도 저장
+// 입력이 PARALLEL_FREQ_MIN 이상이면 count_freq_parallel 함수 사용
+// return value : 읽은 바이트 수
+int read_chars( const unsigned char *data, long long size, int *ch_freq){
+	THREAD_POOL pool;
+	int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
 
-	if(root->right){
-		code[depth] = '1';
-		traverse_tree(root->right, code, depth+1, codes);
+	if(size >= PARALLEL_FREQ_MIN && num_threads > 1 && pool_create(&pool, num_threads)){
+		count_freq_parallel(&pool, data, size, ch_freq);
+		pool_destroy(&pool);
 	}
+	else
+		count_freq(data, size, ch_freq);
 
-	code[depth] = '\0';
+	return (int)size;
 }
 
-// 허프만 트리로부터 허프만 코드를 생성
-// traverse_tree 함수 호출
-void make_huffman_code( tNode *root, char *codes[]){
-	char code[256] = {'\0', };
-	
+// 허프만 코드에 대한 메모리 해제
+void free_huffman_code( char *codes[]){
 	for(int i = 0; i < 256; ++i)
-		codes[i] = NULL;
-
-	traverse_tree(root, code, 0, codes);
+		if(codes[i] != NULL)
+			free(codes[i]);
 }
 
-// 트리 메모리 해제
-void destroyTree( tNode *root){
-	if(root->left != NULL) destroyTree(root->left);
-	if(root->right != NULL) destroyTree(root->right);
-	free(root);
+// 빈도가 0이 아닌 문자들의 키(빈도 << 8 | 문자)를 작은 순서로 key에 저장
+// 힙을 O(n)에 구성한 뒤 최소값을 차례로 꺼냄 (힙 메모리는 스택에 둠)
+// return value : 저장한 문자 수
+static int _sorted_keys( int *ch_freq, long long key[]){
+	HEAP heap;
+	HEAP_ENTRY arr[256];
+	int pos[256], items[256];
+	int n = 0;
+
+	for(int i = 0; i < 256; ++i){
+		if(ch_freq[i] > 0){
+			key[n] = ((long long)ch_freq[i] << 8) | i;
+			items[n++] = i;
+		}
+	}
+
+	heapInit(&heap, arr, pos, 256);
+	heapBuild(&heap, items, key, n);
+	for(int j = 0; j < n; ++j)
+		heapDelete(&heap, &key[j]);
+
+	return n;
 }
 
-// 텍스트 파일을 허프만 코드를 이용하여 바이너리 파일로 인코딩
-// return value : 인코딩된 파일의 바이트 수
-int encoding( char *codes[], FILE *infp, FILE *outfp){
-	int c, len;
-	int bits = 1;
+// leaf 큐(0 ~ num_leaves-1)와 내부 노드 큐(num_leaves ~ num_nodes-1)의 앞에서 빈도가 작은 노드를 꺼냄
+static int _pop_min( HUFFMAN_TREE *tree, int *leaf, int *internal){
+	if(*leaf < tree->num_leaves &&
+			(*internal == tree->num_nodes || tree->nodes[*leaf].freq <= tree->nodes[*internal].freq))
+		return (*leaf)++;
+
+	return (*internal)++;
+}
 
-	while((c = fgetc(infp)) != EOF){
-		fprintf(outfp, "%s", codes[c]);
-		bits += strlen(codes[c]);
+// 허프만 트리를 생성 (two-queue 방식)
+// 1. 빈도가 0이 아닌 문자에 대한 leaf 노드를 빈도순으로 정렬하여 저장 (leaf 큐, 힙으로 정렬)
+// 2. leaf 큐와 내부 노드 큐의 앞에서 빈도가 가장 작은 노드 2개를 꺼냄
+// 3. 두 노드를 자식으로 하는 새 내부 노드를 내부 노드 큐의 뒤에 추가 (빈도는 항상 증가하므로 정렬이 유지됨)
+// 4. 두 큐에 한개의 노드가 남을 때까지 반복
+// return value: 트리의 root 노드의 index (빈도가 0이 아닌 문자가 없으면 -1)
+int make_huffman_tree( int *ch_freq, HUFFMAN_TREE *tree){
+	long long key[256];
+	int n = _sorted_keys(ch_freq, key);
+
+	for(int j = 0; j < n; ++j){
+		tNode *leaf = &tree->nodes[j];
+		leaf->data = (unsigned char)(key[j] & 0xff);
+		leaf->freq = (int)(key[j] >> 8);
+		leaf->left = leaf->right = -1;
+	}
+	tree->num_leaves = tree->num_nodes = n;
+
+	int leaf = 0, internal = n; // 두 큐의 앞
+	while((n - leaf) + (tree->num_nodes - internal) > 1){
+		int min_fst = _pop_min(tree, &leaf, &internal);
+		int min_sec = _pop_min(tree, &leaf, &internal);
+		tNode *node = &tree->nodes[tree->num_nodes++];
+
+		node->data = '\0';
+		node->freq = tree->nodes[min_fst].freq + tree->nodes[min_sec].freq;
+		node->left = (short)min_fst;
+		node->right = (short)min_sec;
 	}
 
-	printf("total bits = %d\n", bits);
+	tree->root = tree->num_nodes - 1;
+	return tree->root;
+}
 
-	int bytes = bits / 8;
+// 허프만 트리를 순회하며 문자별 코드 길이(leaf 노드의 깊이)를 code_len에 저장
+// 부모는 자식보다 index가 크므로 root부터 index 역순으로 깊이를 전파
+// 빈도가 0인 문자는 길이 0, 문자가 하나뿐이면 길이 1
+void traverse_tree( HUFFMAN_TREE *tree, int code_len[]){
+	int depth[MAX_NODES];
 
-	return bytes;
-}
+	for(int i = 0; i < 256; ++i)
+		code_len[i] = 0;
 
-// 바이너리 파일을 허프만 트리를 이용하여 텍스트 파일로 디코딩
-void decoding( tNode *root, FILE *infp, FILE *outfp){
-	int num, bits = 0;
-	char c;
-	tNode* rt = root;
+	if(tree->root < 0) return;
 
-	while((num = fgetc(infp)) != EOF){
-		++bits;
-		if((rt->left == NULL) && (rt->right == NULL)){
-			int n = (int)(rt->data) + 128;
-			c = (char)n;
-			fprintf(outfp, "%c", c);
-			rt = root;
-		}
+	depth[tree->root] = 0;
+	for(int k = tree->root; k >= 0; --k){
+		tNode *node = &tree->nodes[k];
 
-		c = (char)num;
-		if(c == '0') rt = rt->left;
-		if(c == '1') rt = rt->right;
+		if(node->left < 0)
+			code_len[node->data] = (depth[k] > 0) ? depth[k] : 1;
+		else
+			depth[node->left] = depth[node->right] = depth[k] + 1;
 	}
+}
 
-	if((rt->left == NULL) && (rt->right == NULL)){
-		int n = (int)(rt->data) + 128;
-		c = (char)n;
-		fprintf(outfp, "%c", c);
-		rt = root;
+// 코드 길이로부터 canonical 허프만 코드를 생성
+// 길이가 짧은 코드부터, 같은 길이에서는 문자 순서대로 연속된 값을 할당
+// return value : 성공 1, 잘못된 길이 정보(MAX_CODE_BITS 초과 또는 prefix code가 될 수 없음) 0
+int make_canonical_code( int code_len[], unsigned long long code_bits[]){
+	int bl_count[MAX_CODE_BITS + 1] = {0, };
+	unsigned long long next_code[MAX_CODE_BITS + 1];
+	long long left = 1; // 아직 할당되지 않은 코드 공간 (Kraft 부등식 검사)
+
+	for(int i = 0; i < 256; ++i){
+		if(code_len[i] < 0 || code_len[i] > MAX_CODE_BITS) return 0;
+		bl_count[code_len[i]]++;
 	}
+	bl_count[0] = 0;
 
-	printf("total bits = %d\n", bits);
-}
-
-int encoding_binary( char *codes[], FILE *infp, FILE *outfp){
-	int c;
-	int bits = 1;
+	unsigned long long code = 0;
+	for(int len = 1; len <= MAX_CODE_BITS; ++len){
+		code = (code + bl_count[len - 1]) << 1;
+		next_code[len] = code;
 
-	while((c = fgetc(infp)) != EOF){
-		int len = strlen(codes[c]);
-		for(int i = 0; i < len; ++i){
-			int ch = codes[c][i];
-			fwrite(&ch, sizeof(int), 1, outfp);
-		
-		}
-		bits += len;
+		left = (left << 1) - bl_count[len];
+		if(left < 0) return 0;
 	}
 
-	printf("total bits = %d\n", bits);
+	for(int i = 0; i < 256; ++i){
+		code_bits[i] = 0;
+		if(code_len[i] > 0) code_bits[i] = next_code[code_len[i]]++;
+	}
 
-	return bits / 8;
+	return 1;
 }
 
-void decoding_binary( tNode *root, FILE *infp, FILE *outfp){
-	int buffer, bits = 0;
-	tNode* rt = root;
+// package-merge 알고리즘으로 최대 길이가 max_len 이하인 최적의 코드 길이를 계산
+// 1. 빈도가 0이 아닌 문자(leaf)를 빈도순으로 정렬
+// 2. 이전 단계의 목록에서 인접한 두 항목을 묶은 package들과 leaf들을 병합하는 것을 max_len-1번 반복
+// 3. 마지막 목록의 앞쪽 2n-2개를 선택하고, 선택된 package를 이루는 이전 단계의 항목들을 차례로 선택
+// 4. 각 문자의 코드 길이 = 모든 단계에서 선택된 횟수
+// 빈도가 0인 문자는 길이 0
+void package_merge( int *ch_freq, int max_len, int code_len[]){
+	long long key[256];
+	long long prev[512], cur[512]; // 단계별 목록의 가중치
+	unsigned char is_leaf[MAX_CODE_BITS][512]; // 단계별 목록의 각 항목이 leaf인지 여부
+	int n, prev_n;
 
-	while(feof(infp) == 0){
-		fread(&buffer, sizeof(int), 1, infp);
-		++bits;
+	for(int i = 0; i < 256; ++i)
+		code_len[i] = 0;
 
-		if((rt->left == NULL) && (rt->right == NULL)){
-			int n = (int)(rt->data) + 128;
-			char c = (char)n;
-			fprintf(outfp, "%c", c);
-			rt = root;
-		}
+	n = _sorted_keys(ch_freq, key);
+	if(n == 0) return;
+	if(n == 1){
+		code_len[key[0] & 0xff] = 1;
+		return;
+	}
 
-		if(buffer == '0') rt = rt->left;
-		if(buffer == '1') rt = rt->right;
+	for(int j = 0; j < n; ++j){
+		prev[j] = key[j] >> 8;
+		is_leaf[0][j] = 1;
 	}
+	prev_n = n;
+
+	for(int level = 1; level < max_len; ++level){
+		int num_pkg = prev_n / 2, a = 0, b = 0, cur_n = 0;
+
+		// leaf와 package를 가중치 순으로 병합 (같으면 leaf 먼저)
+		while(a < n || b < num_pkg){
+			long long pkg = (b < num_pkg) ? prev[2 * b] + prev[2 * b + 1] : 0;
+
+			if(b == num_pkg || (a < n && (key[a] >> 8) <= pkg)){
+				cur[cur_n] = key[a++] >> 8;
+				is_leaf[level][cur_n++] = 1;
+			}
+			else{
+				cur[cur_n] = pkg;
+				is_leaf[level][cur_n++] = 0;
+				b++;
+			}
+		}
 
-	if((rt->left == NULL) && (rt->right == NULL)){
-		int n = (int)(rt->data) + 128;
-		char c = (char)n;
-		fprintf(outfp, "%c", c);
-		rt = root;
+		memcpy(prev, cur, sizeof(long long) * cur_n);
+		prev_n = cur_n;
 	}
 
-	printf("total bits = %d\n", bits);
-}
\ No newline at end of file
+	// 선택된 항목 중 leaf는 정렬된 leaf의 앞쪽부터, package는 이전 단계 목록의 앞쪽부터 차지함
+	int k = 2 * n - 2;
+	for(int level = max_len - 1; level >= 0 && k > 0; --level){
+		int leaves = 0;
+
+		for(int j = 0; j < k; ++j)
+			leaves += is_leaf[level][j];
+		for(int j = 0; j < leaves; ++j)
+			code_len[key[j] & 0xff]++;
+
+		k = 2 * (k - leaves);
+	}
+}
+
+// 코드 길이가 CODE_LEN_LIMIT을 넘으면 package_merge 함수로 코드 길이를 다시 계산
+void limit_code_len( int *ch_freq, int code_len[]){
+	for(int i = 0; i < 256; ++i){
+		if(code_len[i] > CODE_LEN_LIMIT){
+			package_merge(ch_freq, CODE_LEN_LIMIT, code_len);
+			return;
+		}
+	}
+}
+
+// 허프만 트리로부터 canonical 허프만 코드를 생성하여 codes에 저장
+// traverse_tree 함수로 코드 길이를 구하고 limit_code_len 함수로 길이를 제한한 뒤 make_canonical_code 함수 호출
+// strdup 함수 사용함
+void make_huffman_code( HUFFMAN_TREE *tree, int *ch_freq, char *codes[]){
+	int code_len[256] = {0, };
+	unsigned long long code_bits[256];
+	char code[MAX_CODE_BITS + 1];
+
+	for(int i = 0; i < 256; ++i)
+		codes[i] = NULL;
+
+	traverse_tree(tree, code_len);
+	limit_code_len(ch_freq, code_len);
+	make_canonical_code(code_len, code_bits);
+
+	for(int i = 0; i < 256; ++i){
+		if(code_len[i] == 0) continue;
+
+		for(int k = 0; k < code_len[i]; ++k)
+			code[k] = ((code_bits[i] >> (code_len[i] - 1 - k)) & 1) ? '1' : '0';
+		code[code_len[i]] = '\0';
+
+		codes[i] = strdup(code);
+	}
+}
+
+// 메모리에 올린 텍스트를 허프만 코드를 이용하여 바이너리 파일로 인코딩
+// return value : 인코딩된 파일의 바이트 수
+int encoding( char *codes[], const unsigned char *data, long long size, FILE *outfp){
+	int bits = 1;
+
+	for(long long i = 0; i < size; ++i){
+		fputs(codes[data[i]], outfp);
+		bits += strlen(codes[data[i]]);
+	}
+
+	printf("total bits = %d\n", bits);
+
+	int bytes = bits / 8;
+
+	return bytes;
+}
+
+// 바이너리 파일을 canonical 허프만 코드를 이용하여 텍스트 파일로 디코딩
+// 같은 길이의 canonical 코드는 연속된 값이므로 길이별 첫 코드와 개수만으로 문자를 찾음
+void decoding( char *codes[], FILE *infp, FILE *outfp){
+	int code_len[256];
+	unsigned long long code_bits[256];
+	unsigned long long first_code[MAX_CODE_BITS + 1] = {0, }; // 길이별 첫 번째 코드
+	int first_index[MAX_CODE_BITS + 1] = {0, }; // 길이별 첫 번째 문자의 sorted 내 위치
+	int count[MAX_CODE_BITS + 1] = {0, };
+	unsigned char sorted[256]; // (코드 길이, 문자) 순으로 정렬된 문자
+	int num, bits = 0, n = 0;
+
+	for(int i = 0; i < 256; ++i)
+		code_len[i] = (codes[i] != NULL) ? (int)strlen(codes[i]) : 0;
+
+	if(!make_canonical_code(code_len, code_bits)) return;
+
+	for(int len = 1; len <= MAX_CODE_BITS; ++len){
+		first_index[len] = n;
+		for(int i = 0; i < 256; ++i){
+			if(code_len[i] != len) continue;
+			if(count[len]++ == 0) first_code[len] = code_bits[i];
+			sorted[n++] = (unsigned char)i;
+		}
+	}
+
+	unsigned long long code = 0;
+	int len = 0;
+
+	while((num = fgetc(infp)) != EOF){
+		if(num != '0' && num != '1') continue;
+		++bits;
+
+		code = (code << 1) | (num == '1');
+		len++;
+
+		if(count[len] > 0 && code - first_code[len] < (unsigned long long)count[len]){
+			fputc(sorted[first_index[len] + (int)(code - first_code[len])], outfp);
+			code = 0;
+			len = 0;
+		}
+		else if(len == MAX_CODE_BITS){ // 코드에 없는 비트열
+			code = 0;
+			len = 0;
+		}
+	}
+
+	printf("total bits = %d\n", bits);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void bitwriter_init( BIT_WRITER *bw, FILE *fp){
+	bw->fp = fp;
+	bw->acc = 0;
+	bw->nbits = 0;
+	bw->data = bw->buf;
+	bw->pos = 0;
+	bw->capacity = BITIO_BUFSIZE;
+	bw->written = 0;
+}
+
+// capacity 바이트 크기의 메모리 mem에 출력
+void bitwriter_init_mem( BIT_WRITER *bw, unsigned char *mem, long capacity){
+	bitwriter_init(bw, NULL);
+	bw->data = mem;
+	bw->capacity = capacity;
+}
+
+// acc에 모인 비트 중 완성된 바이트를 버퍼로 옮김
+static void _bitwriter_flush_bytes( BIT_WRITER *bw){
+	while(bw->nbits >= 8){
+		assert(bw->pos < bw->capacity);
+
+		bw->nbits -= 8;
+		bw->data[bw->pos++] = (unsigned char)(bw->acc >> bw->nbits);
+
+		if(bw->pos == bw->capacity && bw->fp != NULL){
+			fwrite(bw->data, 1, bw->pos, bw->fp);
+			bw->written += bw->pos;
+			bw->pos = 0;
+		}
+	}
+}
+
+// len 비트(len <= 56)의 코드를 상위 비트부터 출력
+void bitwriter_put( BIT_WRITER *bw, unsigned long long code, int len){
+	if(bw->nbits + len > 64)
+		_bitwriter_flush_bytes(bw);
+
+	bw->acc = (bw->acc << len) | code;
+	bw->nbits += len;
+}
+
+// 남은 비트를 0으로 채워 바이트 단위로 출력하고 버퍼를 비움
+// return value : 지금까지 출력한 바이트 수
+long bitwriter_finish( BIT_WRITER *bw){
+	_bitwriter_flush_bytes(bw);
+
+	if(bw->nbits > 0){
+		bw->acc <<= 8 - bw->nbits;
+		bw->nbits = 8;
+		_bitwriter_flush_bytes(bw);
+	}
+
+	if(bw->fp != NULL){
+		fwrite(bw->data, 1, bw->pos, bw->fp);
+		bw->written += bw->pos;
+		bw->pos = 0;
+	}
+
+	return bw->written + bw->pos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void bitreader_init( BIT_READER *br, FILE *fp){
+	br->fp = fp;
+	br->acc = 0;
+	br->nbits = 0;
+	br->data = br->buf;
+	br->pos = 0;
+	br->size = 0;
+}
+
+// size 바이트 크기의 메모리 mem에서 입력
+void bitreader_init_mem( BIT_READER *br, const unsigned char *mem, long size){
+	bitreader_init(br, NULL);
+	br->data = mem;
+	br->size = size;
+}
+
+// acc에 57비트 이상이 남도록 채움 (입력 끝 이후는 0으로 채움)
+void bitreader_refill( BIT_READER *br){
+	// 남은 입력이 8 바이트 이상이면 한 번에 채움
+	if(br->nbits <= 56 && br->pos + 8 <= br->size){
+		const unsigned char *p = br->data + br->pos;
+		unsigned long long v = 0;
+		int k = (64 - br->nbits) >> 3; // 채울 바이트 수
+
+		for(int i = 0; i < 8; ++i)
+			v = (v << 8) | p[i];
+
+		br->acc = (k == 8) ? v : (br->acc << (k * 8)) | (v >> (64 - k * 8));
+		br->pos += k;
+		br->nbits += k * 8;
+		return;
+	}
+
+	while(br->nbits <= 56){
+		if(br->pos == br->size && br->fp != NULL){
+			br->size = (long)fread(br->buf, 1, BITIO_BUFSIZE, br->fp);
+			br->pos = 0;
+		}
+
+		unsigned char byte = (br->pos < br->size) ? br->data[br->pos++] : 0;
+		br->acc = (br->acc << 8) | byte;
+		br->nbits += 8;
+	}
+}
+
+// 다음 1비트를 읽음
+int bitreader_getbit( BIT_READER *br){
+	if(br->nbits == 0)
+		bitreader_refill(br);
+
+	br->nbits--;
+	return (int)((br->acc >> br->nbits) & 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 허프만 코드 문자열("0101..")을 비트 값과 길이로 변환
+static void _code_to_bits( char *codes[], unsigned long long code_bits[], int code_len[]){
+	for(int i = 0; i < 256; ++i){
+		code_bits[i] = 0;
+		code_len[i] = 0;
+		if(codes[i] == NULL) continue;
+
+		for(char *p = codes[i]; *p; ++p){
+			code_bits[i] = (code_bits[i] << 1) | (*p == '1');
+			code_len[i]++;
+		}
+	}
+}
+
+// 메모리에 올린 텍스트를 허프만 코드를 이용하여 비트 단위로 압축된 바이너리 파일로 인코딩
+// 파일 형식 : [원본 바이트 수 (unsigned int)] [문자별 코드 길이 (256 바이트)]
+//             [코드 비트열 (MSB부터, 마지막 바이트는 0으로 채움)]
+// return value : 인코딩된 파일의 바이트 수
+int encoding_binary( char *codes[], const unsigned char *data, long long size, FILE *outfp){
+	static BIT_WRITER bw;
+	unsigned long long code_bits[256];
+	int code_len[256];
+	unsigned char header[256];
+	unsigned int num_chars = (unsigned int)size;
+
+	_code_to_bits(codes, code_bits, code_len);
+
+	for(int i = 0; i < 256; ++i)
+		header[i] = (unsigned char)code_len[i];
+
+	fwrite(&num_chars, sizeof(unsigned int), 1, outfp);
+	fwrite(header, 1, sizeof(header), outfp);
+
+	bitwriter_init(&bw, outfp);
+	long long bits = encode_symbols(&bw, code_bits, code_len, data, (long)size);
+
+	long bytes = bitwriter_finish(&bw) + sizeof(unsigned int) + sizeof(header);
+
+	printf("total bits = %lld\n", bits);
+
+	return (int)bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 디코딩 테이블에 n개의 엔트리를 추가
+// return value : 추가된 엔트리의 시작 위치, 메모리 부족 -1
+static int _alloc_entries( DECODE_TABLE *table, int n){
+	if(table->size + n > table->capacity){
+		int capacity = table->capacity * 2;
+		while(capacity < table->size + n) capacity *= 2;
+
+		DECODE_ENTRY *entries = (DECODE_ENTRY *)realloc(table->entries, sizeof(DECODE_ENTRY) * capacity);
+		if(entries == NULL) return -1;
+
+		table->entries = entries;
+		table->capacity = capacity;
+	}
+
+	int offset = table->size;
+	memset(table->entries + offset, 0, sizeof(DECODE_ENTRY) * n);
+	table->size += n;
+
+	return offset;
+}
+
+// 앞의 plen 비트가 prefix인 코드들로 offset 위치의 (1 << bits) 크기 테이블을 채움
+// 남은 길이가 bits보다 긴 코드는 서브테이블을 만들어 재귀적으로 채움
+static int _fill_decode_table( DECODE_TABLE *table, int offset, int bits,
+		unsigned long long prefix, int plen, unsigned long long code_bits[], int code_len[]){
+	int sub_len[1 << DECODE_BITS] = {0, }; // 서브테이블이 필요한 엔트리별 최대 남은 길이
+
+	for(int i = 0; i < 256; ++i){
+		int rem = code_len[i] - plen;
+		if(code_len[i] == 0 || rem <= 0) continue;
+		if((code_bits[i] >> rem) != prefix) continue;
+
+		unsigned long long r = code_bits[i] & ((1ULL << rem) - 1);
+
+		if(rem <= bits){
+			int idx = (int)(r << (bits - rem));
+			for(int k = 0; k < (1 << (bits - rem)); ++k){
+				DECODE_ENTRY *e = &table->entries[offset + idx + k];
+				e->sym[0] = (unsigned char)i;
+				e->count = 1;
+				e->len0 = (unsigned char)rem;
+				e->len = (unsigned char)rem;
+			}
+		}
+		else{
+			int idx = (int)(r >> (rem - bits));
+			if(rem - bits > sub_len[idx]) sub_len[idx] = rem - bits;
+		}
+	}
+
+	for(int idx = 0; idx < (1 << bits); ++idx){
+		if(sub_len[idx] == 0) continue;
+
+		int sub_bits = (sub_len[idx] < DECODE_SUB_BITS) ? sub_len[idx] : DECODE_SUB_BITS;
+		int sub = _alloc_entries(table, 1 << sub_bits);
+		if(sub < 0) return 0;
+
+		DECODE_ENTRY *e = &table->entries[offset + idx];
+		e->count = 0;
+		e->len = (unsigned char)bits;
+		e->bits = (unsigned char)sub_bits;
+		e->sub = (unsigned int)sub;
+
+		if(!_fill_decode_table(table, sub, sub_bits, (prefix << bits) | idx, plen + bits, code_bits, code_len))
+			return 0;
+	}
+
+	return 1;
+}
+
+// 문자별 코드(비트 값, 길이)로부터 디코딩 테이블을 생성
+// 1차 테이블에서 첫 문자의 코드 뒤에 남는 비트로 두 번째 문자까지 결정되면 두 문자를 함께 저장
+// return value : 성공 1, 메모리 부족 0
+int make_decode_table( unsigned long long code_bits[], int code_len[], DECODE_TABLE *table){
+	int mask = (1 << DECODE_BITS) - 1;
+
+	table->capacity = 1 << DECODE_BITS;
+	table->size = 0;
+	table->max_len = 0;
+	table->entries = (DECODE_ENTRY *)malloc(sizeof(DECODE_ENTRY) * table->capacity);
+	if(table->entries == NULL) return 0;
+
+	for(int i = 0; i < 256; ++i)
+		if(code_len[i] > table->max_len) table->max_len = code_len[i];
+
+	_alloc_entries(table, 1 << DECODE_BITS);
+	if(!_fill_decode_table(table, 0, DECODE_BITS, 0, 0, code_bits, code_len)){
+		free_decode_table(table);
+		return 0;
+	}
+
+	for(int idx = 0; idx <= mask; ++idx){
+		DECODE_ENTRY *e = &table->entries[idx];
+		if(e->count != 1 || e->len0 >= DECODE_BITS) continue;
+
+		DECODE_ENTRY *next = &table->entries[(idx << e->len0) & mask];
+		if(next->count == 0 || next->len0 > DECODE_BITS - e->len0) continue;
+
+		e->sym[1] = next->sym[0];
+		e->count = 2;
+		e->len = e->len0 + next->len0;
+	}
+
+	return 1;
+}
+
+// 디코딩 테이블 메모리 해제
+void free_decode_table( DECODE_TABLE *table){
+	free(table->entries);
+	table->entries = NULL;
+	table->size = table->capacity = 0;
+}
+
+// 비트 단위로 압축된 바이너리 파일을 텍스트 파일로 디코딩
+// 헤더의 코드 길이로 canonical 코드와 디코딩 테이블을 만든 뒤 테이블 참조로 디코딩
+// 허프만 트리나 빈도 정보 없이 파일만으로 디코딩 가능
+void decoding_binary( FILE *infp, FILE *outfp){
+	static BIT_READER br;
+	static unsigned char out[BITIO_BUFSIZE];
+	unsigned long long code_bits[256];
+	int code_len[256];
+	unsigned char header[256];
+	DECODE_TABLE table;
+	unsigned int num_chars;
+	long long bits = 0;
+
+	if(fread(&num_chars, sizeof(unsigned int), 1, infp) != 1 ||
+			fread(header, 1, sizeof(header), infp) != sizeof(header))
+		return;
+
+	for(int i = 0; i < 256; ++i)
+		code_len[i] = header[i];
+
+	if(!make_canonical_code(code_len, code_bits)){
+		fprintf(stderr, "Error : corrupted input!\n");
+		return;
+	}
+
+	if(!make_decode_table(code_bits, code_len, &table)){
+		fprintf(stderr, "Error : not enough memory!\n");
+		return;
+	}
+
+	bitreader_init(&br, infp);
+
+	unsigned int remain = num_chars;
+	while(remain > 0){
+		long n = (remain < BITIO_BUFSIZE) ? (long)remain : BITIO_BUFSIZE;
+		long long used = decode_symbols(&table, &br, out, n);
+
+		if(used < 0){
+			fprintf(stderr, "Error : corrupted input!\n");
+			break;
+		}
+
+		fwrite(out, 1, n, outfp);
+		bits += used;
+		remain -= n;
+	}
+
+	free_decode_table(&table);
+
+	printf("total bits = %lld\n", bits);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 작업 스레드 : 작업이 주어지면 번호를 하나씩 가져가 수행
+static void *_pool_worker( void *param){
+	THREAD_POOL *pool = (THREAD_POOL *)param;
+
+	pthread_mutex_lock(&pool->lock);
+	while(1){
+		while(!pool->quit && pool->next_job >= pool->num_jobs)
+			pthread_cond_wait(&pool->work_cv, &pool->lock);
+		if(pool->quit) break;
+
+		int job = pool->next_job++;
+		pthread_mutex_unlock(&pool->lock);
+
+		pool->fn(pool->arg, job);
+
+		pthread_mutex_lock(&pool->lock);
+		if(++pool->done_jobs == pool->num_jobs)
+			pthread_cond_signal(&pool->done_cv);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+// num_threads개의 작업 스레드 생성
+// return value : 성공 1, 실패 0
+int pool_create( THREAD_POOL *pool, int num_threads){
+	if(num_threads < 1) num_threads = 1;
+	if(num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_cv, NULL);
+	pthread_cond_init(&pool->done_cv, NULL);
+	pool->next_job = pool->num_jobs = pool->done_jobs = 0;
+	pool->quit = 0;
+	pool->num_threads = 0;
+
+	for(int i = 0; i < num_threads; ++i){
+		if(pthread_create(&pool->threads[i], NULL, _pool_worker, pool) != 0) break;
+		pool->num_threads++;
+	}
+
+	if(pool->num_threads == 0){
+		pool_destroy(pool);
+		return 0;
+	}
+	return 1;
+}
+
+// fn( arg, 0) ~ fn( arg, num_jobs-1)을 작업 스레드들이 나누어 수행하고 모두 끝날 때까지 대기
+void pool_run( THREAD_POOL *pool, void (*fn)( void *arg, int job), void *arg, int num_jobs){
+	if(num_jobs <= 0) return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->next_job = 0;
+	pool->done_jobs = 0;
+	pool->num_jobs = num_jobs;
+	pthread_cond_broadcast(&pool->work_cv);
+
+	while(pool->done_jobs < pool->num_jobs)
+		pthread_cond_wait(&pool->done_cv, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// 작업 스레드 종료 및 자원 해제
+void pool_destroy( THREAD_POOL *pool){
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->work_cv);
+	pthread_mutex_unlock(&pool->lock);
+
+	for(int i = 0; i < pool->num_threads; ++i)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work_cv);
+	pthread_cond_destroy(&pool->done_cv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 스레드 하나가 빈도를 계산할 구간
+typedef struct
+{
+	const unsigned char *data;
+	long long	size;
+	int		ch_freq[256];
+} FREQ_JOB;
+
+// 빈도 계산 작업 : 구간의 빈도를 작업별 빈도표에 계산
+static void _count_freq_job( void *arg, int job){
+	FREQ_JOB *fj = &((FREQ_JOB *)arg)[job];
+
+	memset(fj->ch_freq, 0, sizeof(fj->ch_freq));
+	count_freq(fj->data, fj->size, fj->ch_freq);
+}
+
+// data를 작업 스레드 수만큼 나누어 스레드별로 count_freq를 수행한 뒤 빈도를 합침
+void count_freq_parallel( THREAD_POOL *pool, const unsigned char *data, long long size, int *ch_freq){
+	FREQ_JOB jobs[MAX_THREADS];
+	int n = pool->num_threads;
+	long long chunk = (size + n - 1) / n;
+
+	for(int k = 0; k < n; ++k){
+		long long begin = (long long)k * chunk;
+		if(begin > size) begin = size;
+
+		jobs[k].data = data + begin;
+		jobs[k].size = (size - begin < chunk) ? size - begin : chunk;
+	}
+
+	pool_run(pool, _count_freq_job, jobs, n);
+
+	for(int k = 0; k < n; ++k)
+		for(int c = 0; c < 256; ++c)
+			ch_freq[c] += jobs[k].ch_freq[c];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BLOCK_RLE로 인코딩했을 때의 (문자, 반복 횟수 - 1) 쌍의 수
+// limit개를 넘으면 더 세지 않고 limit + 1을 돌려줌
+static long _rle_pairs( const unsigned char *data, int size, long limit){
+	long pairs = 0;
+	int i = 0;
+
+	while(i < size && pairs <= limit){
+		int run = 1;
+		while(i + run < size && run < 256 && data[i + run] == data[i]) run++;
+
+		pairs++;
+		i += run;
+	}
+
+	return pairs;
+}
+
+// BLOCK_RLE 인코딩 : 같은 문자가 최대 256번 반복되는 구간을 (문자, 반복 횟수 - 1)로 저장
+static void _rle_encode( const unsigned char *data, int size, unsigned char *out){
+	int i = 0;
+
+	while(i < size){
+		int run = 1;
+		while(i + run < size && run < 256 && data[i + run] == data[i]) run++;
+
+		*out++ = data[i];
+		*out++ = (unsigned char)(run - 1);
+		i += run;
+	}
+}
+
+// BLOCK_RLE 디코딩
+// return value : 정확히 size 바이트로 복원되면 1, 아니면 0
+static int _rle_decode( const unsigned char *in, int in_size, unsigned char *out, int size){
+	int pos = 0;
+
+	if(in_size % 2 != 0) return 0;
+
+	for(int i = 0; i < in_size; i += 2){
+		int run = in[i + 1] + 1;
+		if(pos + run > size) return 0;
+
+		memset(out + pos, in[i], run);
+		pos += run;
+	}
+
+	return pos == size;
+}
+
+// BLOCK_HUFFMAN4에서 stream번째 비트열이 담당하는 구간의 시작 위치와 크기
+static void _stream_range( int raw_size, int stream, int *start, int *size){
+	int quarter = (raw_size + NUM_STREAMS - 1) / NUM_STREAMS;
+	int s = quarter * stream;
+	int e = s + quarter;
+
+	if(s > raw_size) s = raw_size;
+	if(e > raw_size) e = raw_size;
+	*start = s;
+	*size = e - s;
+}
+
+// BLOCK_HUFFMAN4 디코딩 : NUM_STREAMS개의 비트열을 한 루프에서 번갈아 디코딩
+// 비트열끼리는 서로 의존하지 않으므로 CPU가 여러 테이블 조회를 동시에 진행할 수 있음
+// 모든 코드가 1차 테이블에서 한 번에 디코딩되면 한 번 채운 비트로 비트열마다 여러 문자를 디코딩
+// return value : 성공 1, 잘못된 입력 0
+static int _decode_streams( DECODE_TABLE *table, BIT_READER *br, unsigned char *out, int raw_size){
+	int start[NUM_STREAMS], size[NUM_STREAMS];
+	long done = 0;
+
+	for(int k = 0; k < NUM_STREAMS; ++k)
+		_stream_range(raw_size, k, &start[k], &size[k]);
+
+	// 마지막 구간이 가장 짧으므로 그 길이까지는 모든 비트열을 함께 진행
+	if(table->max_len <= DECODE_BITS){
+		int per_refill = 57 / DECODE_BITS; // 한 번 채운 뒤 비트열마다 디코딩할 수 있는 문자 수
+		long common = size[NUM_STREAMS - 1];
+
+		while(done + per_refill <= common){
+			for(int k = 0; k < NUM_STREAMS; ++k)
+				bitreader_refill(&br[k]);
+
+			for(int r = 0; r < per_refill; ++r){
+				for(int k = 0; k < NUM_STREAMS; ++k){
+					DECODE_ENTRY *e = &table->entries[(br[k].acc >> (br[k].nbits - DECODE_BITS)) & ((1 << DECODE_BITS) - 1)];
+					if(e->count == 0) // 코드에 없는 비트열
+						return 0;
+					out[start[k] + done + r] = e->sym[0];
+					br[k].nbits -= e->len0;
+				}
+			}
+			done += per_refill;
+		}
+	}
+
+	// 나머지는 비트열마다 따로 디코딩
+	for(int k = 0; k < NUM_STREAMS; ++k)
+		if(decode_symbols(table, &br[k], out + start[k] + done, size[k] - done) < 0)
+			return 0;
+
+	return 1;
+}
+
+#ifdef ORDER1_MODE
+// 빈도로 길이가 제한된 허프만 코드 길이를 구함 (빈도가 0인 문자는 길이 0)
+static void _make_code_len( int *freq, int code_len[]){
+	HUFFMAN_TREE tree;
+
+	make_huffman_tree(freq, &tree);
+	traverse_tree(&tree, code_len);
+	limit_code_len(freq, code_len);
+}
+
+// 문맥 하나(ctx_freq)를 code_len으로 인코딩할 때의 비트 수
+// 코드가 없는 문자는 테이블에 추가될 것으로 보고 CODE_LEN_LIMIT 비트로 계산
+static long long _context_cost( const int *ctx_freq, const int *code_len){
+	long long bits = 0;
+
+	for(int i = 0; i < 256; ++i)
+		if(ctx_freq[i] > 0)
+			bits += (long long)ctx_freq[i] * (code_len[i] > 0 ? code_len[i] : CODE_LEN_LIMIT);
+
+	return bits;
+}
+
+// 테이블별로 배정된 문맥들의 빈도를 합쳐 코드 길이를 구함
+static void _table_code_len( int (*ctx_freq)[256], const unsigned char *ctx_map, int num_tables, int (*code_len)[256]){
+	int freq[MAX_CONTEXT_TABLES][256];
+
+	memset(freq, 0, sizeof(freq));
+	for(int c = 0; c < 256; ++c)
+		for(int i = 0; i < 256; ++i)
+			freq[ctx_map[c]][i] += ctx_freq[c][i];
+
+	for(int t = 0; t < num_tables; ++t)
+		_make_code_len(freq[t], code_len[t]);
+}
+
+// x * log2(x) (x >= 1), libm 없이 계산
+// log2(m) = 2 / ln2 * atanh((m - 1) / (m + 1)) (m은 [1, 2)로 정규화한 가수)의 급수를 네 항까지 사용 (상대 오차 1e-5 이하)
+static double _xlog2x( int x){
+	int e = 31 - __builtin_clz((unsigned int)x);
+	double m = (double)x / (double)(1u << e);
+	double s = (m - 1) / (m + 1), s2 = s * s;
+
+	return x * (e + 2.8853900817779268 * s * (1 + s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 / 7))));
+}
+
+// 빈도가 freq인 total개의 문자를 엔트로피로 인코딩할 때의 비트 수
+static double _entropy_bits( const int *freq, int total){
+	double bits = (total > 0) ? _xlog2x(total) : 0;
+
+	for(int i = 0; i < 256; ++i)
+		if(freq[i] > 0)
+			bits -= _xlog2x(freq[i]);
+
+	return bits;
+}
+
+// 테이블이 num_tables개인 BLOCK_ORDER1 블록에서 비트열 앞까지의 크기
+static long long _order1_header_size( int num_tables){
+	return 1 + 1 + 256 + 256 * (long long)num_tables + (NUM_STREAMS - 1) * sizeof(unsigned int);
+}
+
+// 256개의 문맥을 num_tables개 이하의 테이블로 묶음
+// 가장 잘 맞는 테이블로도 비용이 가장 큰 문맥을 차례로 새 테이블의 중심으로 고른 뒤
+// 각 문맥을 비트 수가 가장 작은 테이블로 재배정하고 테이블의 코드를 다시 만드는 과정을 반복
+// model->num_tables, ctx_map, code_len, bits를 채움
+static void _cluster_contexts( int (*ctx_freq)[256], const int *ctx_total, int num_tables, ORDER1_MODEL *model){
+	int self_len[256];
+	long long self_cost[256], best_cost[256];
+	int centers = 0;
+
+	for(int c = 0; c < 256; ++c){
+		model->ctx_map[c] = 0;
+		best_cost[c] = -1;
+		self_cost[c] = 0;
+		if(ctx_total[c] > 0){
+			_make_code_len(ctx_freq[c], self_len);
+			self_cost[c] = _context_cost(ctx_freq[c], self_len);
+		}
+	}
+
+	// 중심 선택 : 처음은 빈도가 가장 큰 문맥, 이후는 현재 테이블들로 인코딩할 때 손실이 가장 큰 문맥
+	while(centers < num_tables){
+		int pick = -1;
+		long long pick_loss = 0;
+
+		for(int c = 0; c < 256; ++c){
+			if(ctx_total[c] == 0) continue;
+			long long loss = (centers == 0) ? ctx_total[c] : best_cost[c] - self_cost[c];
+			if(loss > pick_loss){
+				pick = c;
+				pick_loss = loss;
+			}
+		}
+		if(pick < 0) break;
+
+		_make_code_len(ctx_freq[pick], model->code_len[centers]);
+		for(int c = 0; c < 256; ++c){
+			if(ctx_total[c] == 0) continue;
+			long long cost = _context_cost(ctx_freq[c], model->code_len[centers]);
+			if(best_cost[c] < 0 || cost < best_cost[c]){
+				best_cost[c] = cost;
+				model->ctx_map[c] = (unsigned char)centers;
+			}
+		}
+		centers++;
+	}
+	if(centers == 0) centers = 1;
+
+	for(int iter = 0; iter < CLUSTER_ITERATIONS; ++iter){
+		int changed = 0;
+
+		_table_code_len(ctx_freq, model->ctx_map, centers, model->code_len);
+
+		for(int c = 0; c < 256; ++c){
+			if(ctx_total[c] == 0) continue;
+
+			int best = model->ctx_map[c];
+			long long cost = _context_cost(ctx_freq[c], model->code_len[best]);
+			for(int t = 0; t < centers; ++t){
+				long long tcost = _context_cost(ctx_freq[c], model->code_len[t]);
+				if(tcost < cost){
+					best = t;
+					cost = tcost;
+				}
+			}
+			if(best != model->ctx_map[c]){
+				model->ctx_map[c] = (unsigned char)best;
+				changed = 1;
+			}
+		}
+		if(!changed) break;
+	}
+
+	// 비어 있는 테이블을 제거
+	int remap[MAX_CONTEXT_TABLES], used[MAX_CONTEXT_TABLES] = {0, };
+	model->num_tables = 0;
+	for(int c = 0; c < 256; ++c)
+		if(ctx_total[c] > 0) used[model->ctx_map[c]] = 1;
+	for(int t = 0; t < centers; ++t)
+		remap[t] = used[t] ? model->num_tables++ : 0;
+	if(model->num_tables == 0) model->num_tables = 1;
+	for(int c = 0; c < 256; ++c)
+		model->ctx_map[c] = (unsigned char)remap[model->ctx_map[c]];
+
+	_table_code_len(ctx_freq, model->ctx_map, model->num_tables, model->code_len);
+
+	// 비트열별 바이트 단위 올림을 제외한 크기
+	long long bits = 0;
+	for(int c = 0; c < 256; ++c)
+		if(ctx_total[c] > 0)
+			bits += _context_cost(ctx_freq[c], model->code_len[model->ctx_map[c]]);
+	model->size = _order1_header_size(model->num_tables) + (bits + 7) / 8;
+}
+
+// 블록의 문맥별 빈도를 세고 테이블 수를 2, 4, ..., MAX_CONTEXT_TABLES로 바꾸어 가며 가장 작은 모델을 구함
+// 엔트로피로 보아 이득이 없으면 바로, 테이블 2개로도 limit 바이트보다 작아지지 않거나 테이블을 늘려도 작아지지 않으면 중단
+// model->size가 limit 이상이면 추정값이며 stream_bytes는 채우지 않음
+// return value : 성공 1, 메모리 부족 0
+static int _make_order1_model( const unsigned char *data, int size, long long limit, ORDER1_MODEL *model){
+	// 허프만 코드는 문자마다 1비트 이상이므로 (RLE 등이 이미 더 작으면) 문맥별 빈도도 셀 필요가 없음
+	model->num_tables = 0;
+	model->size = _order1_header_size(2) + size / 8;
+	if(model->size >= limit)
+		return 1;
+
+	int (*ctx_freq)[256] = (int (*)[256])calloc(256, sizeof(int[256]));
+	ORDER1_MODEL *trial = (ORDER1_MODEL *)malloc(sizeof(ORDER1_MODEL));
+	int ctx_total[256] = {0, };
+
+	if(ctx_freq == NULL || trial == NULL){
+		free(ctx_freq);
+		free(trial);
+		return 0;
+	}
+
+	for(int k = 0; k < NUM_STREAMS; ++k){
+		int start, len;
+		unsigned char prev = 0;
+
+		_stream_range(size, k, &start, &len);
+		for(int i = start; i < start + len; ++i){
+			ctx_freq[prev][data[i]]++;
+			prev = data[i];
+		}
+	}
+	for(int c = 0; c < 256; ++c)
+		for(int i = 0; i < 256; ++i)
+			ctx_total[c] += ctx_freq[c][i];
+
+	// 문맥을 묶어 보기 전에 엔트로피로 가능성을 확인 (order-0에 가까운 데이터에서 대부분의 시간을 줄임)
+	// 1. 하한 : 문맥마다 엔트로피 이상, 허프만 코드는 문자마다 1비트 이상이므로 이 크기가 limit 이상이면 order-1은 선택될 수 없음
+	// 2. 이득 : order-0 엔트로피 - order-1 엔트로피는 문맥과 문자가 독립이어도 표본 수 때문에 평균 (자유도) / (2 ln 2) 비트만큼 생기므로 (G-검정)
+	//    이를 빼고 문자당 1/16비트(ORDER1_MIN_GAIN)도 남지 않으면 느린 order-1 디코딩을 감수할 만큼 작아지지 않음
+	//    (문맥이 희소하면 G-검정의 근사보다 조금 더 생기므로 여유를 둠)
+	int ch_freq[256] = {0, }, num_ctx = 0, num_sym = 0;
+	double order1_bits = 0, floor_bits = 0;
+
+	for(int c = 0; c < 256; ++c){
+		if(ctx_total[c] == 0) continue;
+		double h = _entropy_bits(ctx_freq[c], ctx_total[c]);
+		order1_bits += h;
+		floor_bits += (h > ctx_total[c]) ? h : ctx_total[c];
+		num_ctx++;
+		for(int i = 0; i < 256; ++i)
+			ch_freq[i] += ctx_freq[c][i];
+	}
+	for(int i = 0; i < 256; ++i)
+		if(ch_freq[i] > 0) num_sym++;
+
+	long long bound = _order1_header_size(2) + (long long)(floor_bits / 8);
+	double gain = _entropy_bits(ch_freq, size) - order1_bits - (num_ctx - 1) * (num_sym - 1) / (2 * 0.6931471805599453);
+	if(bound >= limit || gain < (double)size / ORDER1_MIN_GAIN){
+		model->num_tables = 0;
+		model->size = (bound >= limit) ? bound : limit;
+		free(ctx_freq);
+		free(trial);
+		return 1;
+	}
+
+	model->num_tables = 0;
+	for(int k = 2; k <= MAX_CONTEXT_TABLES; k *= 2){
+		_cluster_contexts(ctx_freq, ctx_total, k, trial);
+		if(model->num_tables > 0 && trial->size >= model->size) break;
+		*model = *trial;
+		if(model->size >= limit || model->num_tables < k) break; // order-0보다 나쁘거나 문맥이 더 없음
+	}
+
+	// 선택될 수 있으면 비트열별 크기를 정확히 계산
+	if(model->size >= limit){
+		free(ctx_freq);
+		free(trial);
+		return 1;
+	}
+
+	model->size = _order1_header_size(model->num_tables);
+	for(int k = 0; k < NUM_STREAMS; ++k){
+		int start, len;
+		unsigned char prev = 0;
+		long long bits = 0;
+
+		_stream_range(size, k, &start, &len);
+		for(int i = start; i < start + len; ++i){
+			bits += model->code_len[model->ctx_map[prev]][data[i]];
+			prev = data[i];
+		}
+		model->stream_bytes[k] = (bits + 7) / 8;
+		model->size += model->stream_bytes[k];
+	}
+
+	free(ctx_freq);
+	free(trial);
+	return 1;
+}
+
+#endif
+
+// BLOCK_ORDER1 인코딩 : 이전 문자가 가리키는 테이블의 코드로 각 문자를 인코딩
+static void _order1_encode( BIT_WRITER *bw, unsigned long long (*code_bits)[256], ORDER1_MODEL *model, const unsigned char *in, long n){
+	unsigned char prev = 0;
+
+	for(long i = 0; i < n; ++i){
+		int t = model->ctx_map[prev];
+		bitwriter_put(bw, code_bits[t][in[i]], model->code_len[t][in[i]]);
+		prev = in[i];
+	}
+}
+
+// BLOCK_ORDER1 비트열 하나를 디코딩 : 이전 문자(처음은 prev)가 가리키는 테이블로 n개의 문자를 디코딩
+// 두 문자가 들어 있는 엔트리는 두 번째 문자의 문맥도 같은 테이블일 때만 두 문자를 함께 사용
+// max_len : 모든 테이블의 최대 코드 길이와 DECODE_BITS 중 큰 값
+// return value : 성공 1, 잘못된 입력 0
+static int _order1_decode( DECODE_TABLE *tables, int max_len, const unsigned char *ctx_map, BIT_READER *br, unsigned char *out, long n, unsigned char prev){
+	long pos = 0;
+
+	while(pos < n){
+		int t = ctx_map[prev];
+		DECODE_TABLE *table = &tables[t];
+
+		if(br->nbits < max_len)
+			bitreader_refill(br);
+
+		DECODE_ENTRY *e = &table->entries[(br->acc >> (br->nbits - DECODE_BITS)) & ((1 << DECODE_BITS) - 1)];
+		while(e->count == 0 && e->bits > 0){
+			br->nbits -= e->len;
+			e = &table->entries[e->sub + ((br->acc >> (br->nbits - e->bits)) & ((1 << e->bits) - 1))];
+		}
+
+		if(e->count == 0) // 코드에 없는 비트열
+			return 0;
+
+		if(e->count == 2 && pos + 1 < n && ctx_map[e->sym[0]] == t){
+			out[pos++] = e->sym[0];
+			out[pos++] = e->sym[1];
+			br->nbits -= e->len;
+		}
+		else{
+			out[pos++] = e->sym[0];
+			br->nbits -= e->len0;
+		}
+		prev = out[pos - 1];
+	}
+
+	return 1;
+}
+
+// BLOCK_ORDER1 디코딩 : _decode_streams와 같이 NUM_STREAMS개의 비트열을 한 루프에서 번갈아 디코딩
+// 비트열마다 이전 문자를 따로 가지므로 테이블 선택의 의존성이 비트열 사이에는 없음
+// return value : 성공 1, 잘못된 입력 0
+static int _decode_order1_streams( DECODE_TABLE *tables, int max_len, const unsigned char *ctx_map, BIT_READER *br, unsigned char *out, int raw_size){
+	int start[NUM_STREAMS], size[NUM_STREAMS];
+	unsigned char prev[NUM_STREAMS] = {0, };
+	const DECODE_ENTRY *ctx_entries[256]; // 문맥별 1차 테이블 (테이블 번호를 거치지 않고 한 번의 참조로 찾음)
+	long done = 0;
+
+	for(int k = 0; k < NUM_STREAMS; ++k)
+		_stream_range(raw_size, k, &start[k], &size[k]);
+	for(int c = 0; c < 256; ++c)
+		ctx_entries[c] = tables[ctx_map[c]].entries;
+
+	if(max_len <= DECODE_BITS){
+		int per_refill = 57 / DECODE_BITS;
+		long common = size[NUM_STREAMS - 1];
+
+		while(done + per_refill <= common){
+			for(int k = 0; k < NUM_STREAMS; ++k)
+				bitreader_refill(&br[k]);
+
+			for(int r = 0; r < per_refill; ++r){
+				for(int k = 0; k < NUM_STREAMS; ++k){
+					const DECODE_ENTRY *e = &ctx_entries[prev[k]][(br[k].acc >> (br[k].nbits - DECODE_BITS)) & ((1 << DECODE_BITS) - 1)];
+					if(e->count == 0) // 코드에 없는 비트열
+						return 0;
+					out[start[k] + done + r] = prev[k] = e->sym[0];
+					br[k].nbits -= e->len0;
+				}
+			}
+			done += per_refill;
+		}
+	}
+
+	for(int k = 0; k < NUM_STREAMS; ++k)
+		if(!_order1_decode(tables, max_len, ctx_map, &br[k], out + start[k] + done, size[k] - done, prev[k]))
+			return 0;
+
+	return 1;
+}
+
+// 블록 인코딩 작업 : 블록의 빈도로 블록 전용 canonical 코드를 만들고
+// 허프만 코드, 원본 저장, RLE 중 크기가 가장 작은 종류로 압축
+// 허프만 코드의 크기는 빈도와 코드 길이로 정확히 계산되므로 인코딩하기 전에 결정할 수 있음
+// INTERLEAVED_MODE에서는 충분히 큰 블록의 허프만 코드를 BLOCK_HUFFMAN4로 인코딩
+// ORDER1_MODE에서는 충분히 큰 블록에 대해 BLOCK_ORDER1의 크기도 계산하여 허프만 코드보다 작으면 선택
+static void _encode_block_job( void *arg, int job){
+	BLOCK *block = &((BLOCK *)arg)[job];
+	int ch_freq[256] = {0, };
+	int stream_freq[NUM_STREAMS][256];
+	int code_len[256] = {0, };
+	unsigned long long code_bits[256];
+	HUFFMAN_TREE tree;
+	long long bits = 0;
+	long long stream_bytes[NUM_STREAMS];
+	int num_streams = 1;
+	ORDER1_MODEL *model = NULL;
+	BIT_WRITER *bw;
+
+#ifdef INTERLEAVED_MODE
+	if(block->raw_size >= STREAMS_MIN_SIZE)
+		num_streams = NUM_STREAMS;
+#endif
+
+	// 비트열별 크기를 알기 위해 구간마다 빈도를 따로 셈
+	memset(stream_freq, 0, sizeof(stream_freq));
+	for(int k = 0; k < num_streams; ++k){
+		int start, size;
+
+		if(num_streams == 1){ start = 0; size = block->raw_size; }
+		else _stream_range(block->raw_size, k, &start, &size);
+		count_freq(block->raw + start, size, stream_freq[k]);
+
+		for(int i = 0; i < 256; ++i)
+			ch_freq[i] += stream_freq[k][i];
+	}
+
+	make_huffman_tree(ch_freq, &tree);
+	traverse_tree(&tree, code_len);
+	limit_code_len(ch_freq, code_len);
+	make_canonical_code(code_len, code_bits);
+
+	for(int k = 0; k < num_streams; ++k){
+		long long stream_bits = 0;
+
+		for(int i = 0; i < 256; ++i)
+			stream_bits += (long long)stream_freq[k][i] * code_len[i];
+		stream_bytes[k] = (stream_bits + 7) / 8;
+		bits += stream_bytes[k] * 8;
+	}
+
+	long long huffman_size = 1 + 256 + bits / 8;
+	if(num_streams > 1)
+		huffman_size += (NUM_STREAMS - 1) * sizeof(unsigned int);
+
+	int huffman_mode = (num_streams > 1) ? BLOCK_HUFFMAN4 : BLOCK_HUFFMAN;
+	long long stored_size = 1 + (long long)block->raw_size;
+	long long best = (huffman_size < stored_size) ? huffman_size : stored_size;
+	long long rle_size = 1 + 2 * (long long)_rle_pairs(block->raw, block->raw_size, (long)(best / 2));
+
+#ifdef ORDER1_MODE
+	// 다른 모든 종류보다 작을 때만 BLOCK_ORDER1 선택
+	// 원본 저장이 order-0 허프만 코드보다 작으면 (압축되지 않는 블록) order-1 모델도 만들지 않음
+	if(block->raw_size >= ORDER1_MIN_SIZE && huffman_size < stored_size){
+		long long limit = (rle_size < best) ? rle_size : best;
+
+		model = (ORDER1_MODEL *)malloc(sizeof(ORDER1_MODEL));
+		if(model == NULL || !_make_order1_model(block->raw, block->raw_size, limit, model)){
+			free(model);
+			block->error = 1;
+			return;
+		}
+		if(model->size < limit){
+			huffman_size = best = model->size;
+			huffman_mode = BLOCK_ORDER1;
+		}
+	}
+#endif
+
+	// 크기가 같으면 디코딩이 빠른 종류를 선택
+	int mode = huffman_mode;
+	if(stored_size <= huffman_size) mode = BLOCK_STORED;
+	if(rle_size <= best) mode = BLOCK_RLE;
+
+	block->comp_size = (int)((mode == BLOCK_STORED) ? stored_size : (mode == BLOCK_RLE) ? rle_size : huffman_size);
+	block->comp = (unsigned char *)malloc(block->comp_size);
+	if(block->comp == NULL){
+		free(model);
+		block->error = 1;
+		return;
+	}
+
+	block->comp[0] = (unsigned char)mode;
+
+	if(mode == BLOCK_STORED){
+		memcpy(block->comp + 1, block->raw, block->raw_size);
+		free(model);
+		return;
+	}
+	if(mode == BLOCK_RLE){
+		_rle_encode(block->raw, block->raw_size, block->comp + 1);
+		free(model);
+		return;
+	}
+
+	bw = (BIT_WRITER *)malloc(sizeof(BIT_WRITER));
+	if(bw == NULL){
+		free(block->comp);
+		block->comp = NULL;
+		free(model);
+		block->error = 1;
+		return;
+	}
+
+	if(mode == BLOCK_ORDER1){
+		unsigned long long (*table_bits)[256] = (unsigned long long (*)[256])malloc(sizeof(unsigned long long[256]) * model->num_tables);
+		unsigned char *p = block->comp + 1;
+
+		if(table_bits == NULL){
+			free(block->comp);
+			block->comp = NULL;
+			block->error = 1;
+		}
+		else{
+			*p++ = (unsigned char)model->num_tables;
+			memcpy(p, model->ctx_map, 256);
+			p += 256;
+			for(int t = 0; t < model->num_tables; ++t){
+				for(int i = 0; i < 256; ++i)
+					*p++ = (unsigned char)model->code_len[t][i];
+				make_canonical_code(model->code_len[t], table_bits[t]);
+			}
+
+			for(int k = 0; k < NUM_STREAMS - 1; ++k){
+				unsigned int jump = (unsigned int)model->stream_bytes[k];
+				memcpy(p, &jump, sizeof(unsigned int));
+				p += sizeof(unsigned int);
+			}
+
+			for(int k = 0; k < NUM_STREAMS; ++k){
+				int start, size;
+
+				_stream_range(block->raw_size, k, &start, &size);
+				bitwriter_init_mem(bw, p, model->stream_bytes[k]);
+				_order1_encode(bw, table_bits, model, block->raw + start, size);
+				bitwriter_finish(bw);
+				p += model->stream_bytes[k];
+			}
+			free(table_bits);
+		}
+		free(bw);
+		free(model);
+		return;
+	}
+	free(model);
+
+	for(int i = 0; i < 256; ++i)
+		block->comp[1 + i] = (unsigned char)code_len[i];
+
+	if(mode == BLOCK_HUFFMAN){
+		bitwriter_init_mem(bw, block->comp + 257, block->comp_size - 257);
+		encode_symbols(bw, code_bits, code_len, block->raw, block->raw_size);
+		bitwriter_finish(bw);
+		free(bw);
+		return;
+	}
+
+	// 점프 테이블 뒤에 비트열들을 차례로 기록
+	unsigned char *p = block->comp + 257 + (NUM_STREAMS - 1) * sizeof(unsigned int);
+	for(int k = 0; k < NUM_STREAMS; ++k){
+		int start, size;
+
+		if(k < NUM_STREAMS - 1){
+			unsigned int jump = (unsigned int)stream_bytes[k];
+			memcpy(block->comp + 257 + k * sizeof(unsigned int), &jump, sizeof(unsigned int));
+		}
+
+		_stream_range(block->raw_size, k, &start, &size);
+		bitwriter_init_mem(bw, p, stream_bytes[k]);
+		encode_symbols(bw, code_bits, code_len, block->raw + start, size);
+		bitwriter_finish(bw);
+		p += stream_bytes[k];
+	}
+	free(bw);
+}
+
+// 블록의 pos 위치에 있는 점프 테이블로 NUM_STREAMS개의 비트열 입력기를 초기화
+// return value : 성공 1, 점프 테이블이 블록 범위를 벗어나면 0
+static int _init_stream_readers( BIT_READER *br, BLOCK *block, long pos){
+	const unsigned char *jumps = block->comp + pos;
+	long remain;
+
+	pos += (NUM_STREAMS - 1) * sizeof(unsigned int);
+	remain = block->comp_size - pos;
+	if(remain < 0) return 0;
+
+	for(int k = 0; k < NUM_STREAMS; ++k){
+		unsigned int jump = (unsigned int)remain;
+
+		if(k < NUM_STREAMS - 1)
+			memcpy(&jump, jumps + k * sizeof(unsigned int), sizeof(unsigned int));
+		if(jump > (unsigned long)remain) return 0;
+
+		bitreader_init_mem(&br[k], block->comp + pos, jump);
+		pos += jump;
+		remain -= jump;
+	}
+
+	return 1;
+}
+
+// BLOCK_ORDER1 블록 복원 : 테이블마다 디코딩 테이블을 만들어 문맥에 따라 선택
+// return value : 성공 1, 잘못된 입력 또는 메모리 부족 0
+static int _decode_order1_block( BLOCK *block){
+	DECODE_TABLE tables[MAX_CONTEXT_TABLES];
+	int code_len[256];
+	unsigned long long code_bits[256];
+	BIT_READER *br;
+	int num_tables, max_len = DECODE_BITS, ok = 1;
+
+	if(block->comp_size < 2) return 0;
+	num_tables = block->comp[1];
+	long pos = 2 + 256 + 256 * (long)num_tables;
+	if(num_tables < 1 || num_tables > MAX_CONTEXT_TABLES || block->comp_size < pos) return 0;
+
+	const unsigned char *ctx_map = block->comp + 2;
+	for(int c = 0; c < 256; ++c)
+		if(ctx_map[c] >= num_tables) return 0;
+
+	memset(tables, 0, sizeof(tables));
+	for(int t = 0; t < num_tables && ok; ++t){
+		for(int i = 0; i < 256; ++i)
+			code_len[i] = block->comp[2 + 256 + 256 * t + i];
+		ok = make_canonical_code(code_len, code_bits) && make_decode_table(code_bits, code_len, &tables[t]);
+		if(ok && tables[t].max_len > max_len) max_len = tables[t].max_len;
+	}
+
+	br = ok ? (BIT_READER *)malloc(NUM_STREAMS * sizeof(BIT_READER)) : NULL;
+	if(br != NULL){
+		ok = _init_stream_readers(br, block, pos) && _decode_order1_streams(tables, max_len, ctx_map, br, block->raw, block->raw_size);
+		free(br);
+	}
+	else ok = 0;
+
+	for(int t = 0; t < num_tables; ++t)
+		if(tables[t].entries != NULL) free_decode_table(&tables[t]);
+
+	return ok;
+}
+
+// 블록 디코딩 작업 : 블록 종류에 따라 복원
+// 허프만 코드 블록은 코드 길이로 디코딩 테이블을 만들어 복원
+static void _decode_block_job( void *arg, int job){
+	BLOCK *block = &((BLOCK *)arg)[job];
+	int code_len[256];
+	unsigned long long code_bits[256];
+	DECODE_TABLE table;
+	BIT_READER *br;
+
+	if(block->comp_size < 1){
+		block->error = 1;
+		return;
+	}
+
+	if(block->comp[0] == BLOCK_STORED){
+		if(block->comp_size - 1 != block->raw_size) block->error = 1;
+		else memcpy(block->raw, block->comp + 1, block->raw_size);
+		return;
+	}
+	if(block->comp[0] == BLOCK_RLE){
+		if(!_rle_decode(block->comp + 1, block->comp_size - 1, block->raw, block->raw_size)) block->error = 1;
+		return;
+	}
+	if(block->comp[0] == BLOCK_ORDER1){
+		if(!_decode_order1_block(block)) block->error = 1;
+		return;
+	}
+	if((block->comp[0] != BLOCK_HUFFMAN && block->comp[0] != BLOCK_HUFFMAN4) || block->comp_size < 257){
+		block->error = 1;
+		return;
+	}
+
+	for(int i = 0; i < 256; ++i)
+		code_len[i] = block->comp[1 + i];
+
+	if(!make_canonical_code(code_len, code_bits) || !make_decode_table(code_bits, code_len, &table)){
+		block->error = 1;
+		return;
+	}
+
+	int num_streams = (block->comp[0] == BLOCK_HUFFMAN4) ? NUM_STREAMS : 1;
+	br = (BIT_READER *)malloc(num_streams * sizeof(BIT_READER));
+	if(br == NULL){
+		free_decode_table(&table);
+		block->error = 1;
+		return;
+	}
+
+	if(num_streams == 1){
+		bitreader_init_mem(br, block->comp + 257, block->comp_size - 257);
+		if(decode_symbols(&table, br, block->raw, block->raw_size) < 0)
+			block->error = 1;
+	}
+	else{
+		if(!_init_stream_readers(br, block, 257) || !_decode_streams(&table, br, block->raw, block->raw_size))
+			block->error = 1;
+	}
+
+	free(br);
+	free_decode_table(&table);
+}
+
+// fread가 요청보다 적게 읽는 경우에도 size 바이트를 채울 때까지 읽음
+// return value : 읽은 바이트 수 (파일 끝이면 size보다 작음)
+static long _read_full( FILE *fp, unsigned char *buf, long size){
+	long total = 0;
+
+	while(total < size){
+		size_t n = fread(buf + total, 1, size - total, fp);
+		if(n == 0) break;
+		total += (long)n;
+	}
+
+	return total;
+}
+
+// 한 번에 처리할 블록 수 (스레드 수의 배수)
+static int _batch_blocks( THREAD_POOL *pool){
+	return pool->num_threads * 2;
+}
+
+// 입력 파일을 BLOCK_SIZE 단위의 독립된 블록으로 나누어 스레드 풀에서 병렬로 인코딩
+// 파일 형식 : [BLOCK_MAGIC] [블록 크기 (unsigned int)] [블록 0] [블록 1] ...
+//             [블록별 (원본 크기, 압축 크기) (unsigned int 2개) 인덱스] [블록 수 (unsigned int)] [BLOCK_MAGIC]
+// num_bytes : 입력 파일의 바이트 수를 저장
+// return value : 인코딩된 파일의 바이트 수, 실패 -1
+long long block_encoding( INPUT *in, FILE *outfp, long long *num_bytes){
+	THREAD_POOL pool;
+	unsigned int block_size = BLOCK_SIZE;
+	unsigned int *index = NULL; // 블록별 (원본 크기, 압축 크기)
+	unsigned int num_blocks = 0, index_capacity = 0;
+	long long total = 0;
+	int ok = 1;
+
+	*num_bytes = 0;
+
+	if(!pool_create(&pool, (int)sysconf(_SC_NPROCESSORS_ONLN))) return -1;
+
+	int batch = _batch_blocks(&pool);
+	BLOCK *blocks = (BLOCK *)calloc(batch, sizeof(BLOCK));
+	unsigned char *raw = NULL; // read()로 읽을 때만 사용 (mmap된 입력은 매핑된 메모리를 그대로 사용)
+	if(in->data == NULL)
+		raw = (unsigned char *)malloc((size_t)batch * BLOCK_SIZE);
+	if(blocks == NULL || (in->data == NULL && raw == NULL)){
+		free(blocks);
+		free(raw);
+		pool_destroy(&pool);
+		return -1;
+	}
+
+	fwrite(BLOCK_MAGIC, 1, 4, outfp);
+	fwrite(&block_size, sizeof(unsigned int), 1, outfp);
+	total += 4 + sizeof(unsigned int);
+
+	while(ok){
+		int n = 0;
+
+		// 블록들을 한 번에 읽어 들임
+		while(n < batch){
+			const unsigned char *ptr;
+
+			// 인코딩 작업은 raw를 읽기만 하므로 매핑된 메모리를 직접 가리켜도 됨
+			blocks[n].raw_size = (int)input_read(in, raw + (size_t)n * BLOCK_SIZE, BLOCK_SIZE, &ptr);
+			blocks[n].raw = (unsigned char *)ptr;
+			blocks[n].comp = NULL;
+			blocks[n].error = 0;
+			if(blocks[n].raw_size == 0) break;
+
+			*num_bytes += blocks[n].raw_size;
+			if(blocks[n++].raw_size < BLOCK_SIZE) break;
+		}
+		if(n == 0) break;
+
+		pool_run(&pool, _encode_block_job, blocks, n);
+
+		// 블록 순서대로 출력
+		for(int k = 0; k < n; ++k){
+			if(blocks[k].error){
+				ok = 0;
+				continue;
+			}
+
+			if(num_blocks == index_capacity){
+				index_capacity = (index_capacity == 0) ? 64 : index_capacity * 2;
+				unsigned int *p = (unsigned int *)realloc(index, sizeof(unsigned int) * 2 * index_capacity);
+				if(p == NULL){
+					ok = 0;
+					free(blocks[k].comp);
+					continue;
+				}
+				index = p;
+			}
+
+			index[2 * num_blocks] = (unsigned int)blocks[k].raw_size;
+			index[2 * num_blocks + 1] = (unsigned int)blocks[k].comp_size;
+			num_blocks++;
+
+			fwrite(blocks[k].comp, 1, blocks[k].comp_size, outfp);
+			total += blocks[k].comp_size;
+			free(blocks[k].comp);
+		}
+
+		if(blocks[n - 1].raw_size < BLOCK_SIZE) break;
+	}
+
+	if(num_blocks > 0)
+		fwrite(index, sizeof(unsigned int), 2 * (size_t)num_blocks, outfp);
+	fwrite(&num_blocks, sizeof(unsigned int), 1, outfp);
+	fwrite(BLOCK_MAGIC, 1, 4, outfp);
+	total += sizeof(unsigned int) * (2 * (long long)num_blocks + 1) + 4;
+
+	free(index);
+	free(blocks);
+	free(raw);
+	pool_destroy(&pool);
+
+	return ok ? total : -1;
+}
+
+// 블록 인덱스를 읽고 블록들을 스레드 풀에서 병렬로 디코딩
+// return value : 성공 1, 실패 0
+int block_decoding( FILE *infp, FILE *outfp){
+	THREAD_POOL pool;
+	char magic[4];
+	unsigned int block_size, num_blocks;
+	unsigned int *index;
+	int ok = 1;
+
+	// 파일 끝의 블록 수와 인덱스를 먼저 읽음
+	if(fseek(infp, -(long)(4 + sizeof(unsigned int)), SEEK_END) != 0 ||
+			fread(&num_blocks, sizeof(unsigned int), 1, infp) != 1 ||
+			fread(magic, 1, 4, infp) != 4 || memcmp(magic, BLOCK_MAGIC, 4) != 0){
+		fprintf(stderr, "Error : not a block-mode file!\n");
+		return 0;
+	}
+
+	index = (unsigned int *)malloc(sizeof(unsigned int) * 2 * ((size_t)num_blocks + 1));
+	if(index == NULL) return 0;
+
+	if(fseek(infp, -(long)(4 + sizeof(unsigned int) * (2 * (size_t)num_blocks + 1)), SEEK_END) != 0 ||
+			fread(index, sizeof(unsigned int), 2 * (size_t)num_blocks, infp) != 2 * (size_t)num_blocks){
+		free(index);
+		return 0;
+	}
+
+	fseek(infp, 0, SEEK_SET);
+	if(fread(magic, 1, 4, infp) != 4 || fread(&block_size, sizeof(unsigned int), 1, infp) != 1){
+		free(index);
+		return 0;
+	}
+
+	for(unsigned int k = 0; k < num_blocks; ++k){
+		if(index[2 * k] > block_size){
+			fprintf(stderr, "Error : corrupted input!\n");
+			free(index);
+			return 0;
+		}
+	}
+
+	if(!pool_create(&pool, (int)sysconf(_SC_NPROCESSORS_ONLN))){
+		free(index);
+		return 0;
+	}
+
+	int batch = _batch_blocks(&pool);
+	BLOCK *blocks = (BLOCK *)calloc(batch, sizeof(BLOCK));
+	unsigned char *raw = (unsigned char *)malloc((size_t)batch * block_size);
+	if(blocks == NULL || raw == NULL) ok = 0;
+
+	for(unsigned int first = 0; ok && first < num_blocks; first += batch){
+		int n = (num_blocks - first < (unsigned int)batch) ? (int)(num_blocks - first) : batch;
+
+		// 압축된 블록들을 순서대로 읽어 들임
+		for(int k = 0; k < n; ++k){
+			blocks[k].raw = raw + (size_t)k * block_size;
+			blocks[k].raw_size = (int)index[2 * (first + k)];
+			blocks[k].comp_size = (int)index[2 * (first + k) + 1];
+			blocks[k].comp = (unsigned char *)malloc(blocks[k].comp_size);
+			blocks[k].error = (blocks[k].comp == NULL) ||
+				(_read_full(infp, blocks[k].comp, blocks[k].comp_size) != blocks[k].comp_size);
+		}
+
+		pool_run(&pool, _decode_block_job, blocks, n);
+
+		for(int k = 0; k < n; ++k){
+			if(blocks[k].error) ok = 0;
+			else if(ok) fwrite(blocks[k].raw, 1, blocks[k].raw_size, outfp);
+			free(blocks[k].comp);
+		}
+	}
+
+	if(!ok) fprintf(stderr, "Error : corrupted input!\n");
+
+	free(index);
+	free(blocks);
+	free(raw);
+	pool_destroy(&pool);
+
+	return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 인코더 초기화 및 STREAM_MAGIC 출력
+// return value : 성공 1, 메모리 부족 0
+int huff_encoder_init( HUFF_ENCODER *enc, FILE *outfp){
+	enc->outfp = outfp;
+	enc->size = 0;
+	enc->in_bytes = 0;
+	enc->out_bytes = 4;
+	enc->error = 0;
+	enc->buf = (unsigned char *)malloc(BLOCK_SIZE);
+	if(enc->buf == NULL) return 0;
+
+	fwrite(STREAM_MAGIC, 1, 4, outfp);
+	return 1;
+}
+
+// size 바이트(size <= BLOCK_SIZE)를 블록 하나로 인코딩하여 블록 헤더와 함께 출력
+static void _write_stream_block( HUFF_ENCODER *enc, const unsigned char *data, int size){
+	BLOCK block;
+	unsigned int header[2];
+
+	// 인코딩 작업은 raw를 읽기만 함
+	block.raw = (unsigned char *)data;
+	block.raw_size = size;
+	block.comp = NULL;
+	block.error = 0;
+
+	_encode_block_job(&block, 0);
+	if(block.error){
+		enc->error = 1;
+		return;
+	}
+
+	header[0] = (unsigned int)block.raw_size;
+	header[1] = (unsigned int)block.comp_size;
+	fwrite(header, sizeof(unsigned int), 2, enc->outfp);
+	fwrite(block.comp, 1, block.comp_size, enc->outfp);
+	enc->out_bytes += STREAM_BLOCK_HEADER + block.comp_size;
+
+	free(block.comp);
+}
+
+// size 바이트의 입력 추가, 블록이 찰 때마다 인코딩하여 출력
+// return value : 성공 1, 실패 0
+int huff_encoder_update( HUFF_ENCODER *enc, const unsigned char *data, long size){
+	enc->in_bytes += size;
+
+	while(size > 0 && !enc->error){
+		// 모아 둔 입력이 없고 블록 하나 이상이 주어지면 복사 없이 바로 인코딩
+		if(enc->size == 0 && size >= BLOCK_SIZE){
+			_write_stream_block(enc, data, BLOCK_SIZE);
+			data += BLOCK_SIZE;
+			size -= BLOCK_SIZE;
+			continue;
+		}
+
+		long n = (BLOCK_SIZE - enc->size < size) ? BLOCK_SIZE - enc->size : size;
+		memcpy(enc->buf + enc->size, data, n);
+		enc->size += (int)n;
+		data += n;
+		size -= n;
+
+		if(enc->size == BLOCK_SIZE){
+			_write_stream_block(enc, enc->buf, enc->size);
+			enc->size = 0;
+		}
+	}
+
+	return !enc->error;
+}
+
+// 남은 입력을 마지막 블록으로 출력하고 스트림 끝 표시 후 메모리 해제
+// return value : 성공 1, 실패 0
+int huff_encoder_finish( HUFF_ENCODER *enc){
+	unsigned int header[2] = {0, 0};
+
+	if(enc->size > 0 && !enc->error)
+		_write_stream_block(enc, enc->buf, enc->size);
+
+	fwrite(header, sizeof(unsigned int), 2, enc->outfp);
+	enc->out_bytes += STREAM_BLOCK_HEADER;
+	fflush(enc->outfp);
+
+	free(enc->buf);
+	enc->buf = NULL;
+
+	return !enc->error;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 디코더 초기화
+// return value : 성공 1, 메모리 부족 0
+int huff_decoder_init( HUFF_DECODER *dec, FILE *outfp){
+	dec->outfp = outfp;
+	dec->state = 0;
+	dec->header_size = 0;
+	dec->comp_filled = 0;
+	dec->out_bytes = 0;
+	dec->error = 0;
+	dec->block.raw = (unsigned char *)malloc(BLOCK_SIZE);
+	dec->block.comp = (unsigned char *)malloc(MAX_COMP_BLOCK);
+
+	if(dec->block.raw == NULL || dec->block.comp == NULL){
+		free(dec->block.raw);
+		free(dec->block.comp);
+		dec->block.raw = dec->block.comp = NULL;
+		return 0;
+	}
+	return 1;
+}
+
+// comp에 모인 블록 하나를 디코딩하여 출력
+static void _flush_stream_block( HUFF_DECODER *dec, unsigned char *comp){
+	BLOCK block = dec->block;
+
+	block.comp = comp;
+	block.error = 0;
+
+	_decode_block_job(&block, 0);
+	if(block.error){
+		dec->error = 1;
+		return;
+	}
+
+	fwrite(block.raw, 1, block.raw_size, dec->outfp);
+	dec->out_bytes += block.raw_size;
+}
+
+// 압축된 스트림 size 바이트 추가, 블록이 완성될 때마다 디코딩하여 출력
+// return value : 성공 1, 잘못된 입력 0
+int huff_decoder_update( HUFF_DECODER *dec, const unsigned char *data, long size){
+	while(size > 0 && !dec->error){
+		if(dec->state == 0 || dec->state == 1){
+			int need = (dec->state == 0) ? 4 : STREAM_BLOCK_HEADER;
+			long n = (need - dec->header_size < size) ? need - dec->header_size : size;
+
+			memcpy(dec->header + dec->header_size, data, n);
+			dec->header_size += (int)n;
+			data += n;
+			size -= n;
+			if(dec->header_size < need) break;
+
+			dec->header_size = 0;
+			if(dec->state == 0){
+				if(memcmp(dec->header, STREAM_MAGIC, 4) != 0) dec->error = 1;
+				dec->state = 1;
+				continue;
+			}
+
+			unsigned int header[2];
+			memcpy(header, dec->header, sizeof(header));
+
+			if(header[0] == 0){ // 스트림 끝
+				dec->state = 3;
+				continue;
+			}
+			if(header[0] > BLOCK_SIZE || header[1] < 1 || header[1] > MAX_COMP_BLOCK){
+				dec->error = 1;
+				break;
+			}
+
+			dec->block.raw_size = (int)header[0];
+			dec->block.comp_size = (int)header[1];
+			dec->comp_filled = 0;
+			dec->state = 2;
+		}
+		else if(dec->state == 2){
+			// 블록 전체가 한 번에 주어지면 복사 없이 바로 디코딩
+			if(dec->comp_filled == 0 && size >= dec->block.comp_size){
+				_flush_stream_block(dec, (unsigned char *)data);
+				data += dec->block.comp_size;
+				size -= dec->block.comp_size;
+				dec->state = 1;
+				continue;
+			}
+
+			long n = (dec->block.comp_size - dec->comp_filled < size) ? dec->block.comp_size - dec->comp_filled : size;
+			memcpy(dec->block.comp + dec->comp_filled, data, n);
+			dec->comp_filled += (int)n;
+			data += n;
+			size -= n;
+
+			if(dec->comp_filled == dec->block.comp_size){
+				_flush_stream_block(dec, dec->block.comp);
+				dec->state = 1;
+			}
+		}
+		else // 스트림 끝 이후의 데이터
+			dec->error = 1;
+	}
+
+	return !dec->error;
+}
+
+// 메모리 해제
+// return value : 스트림 끝까지 올바르게 디코딩했으면 1, 아니면 0
+int huff_decoder_finish( HUFF_DECODER *dec){
+	free(dec->block.raw);
+	free(dec->block.comp);
+	dec->block.raw = dec->block.comp = NULL;
+	fflush(dec->outfp);
+
+	return !dec->error && dec->state == 3;
+}
+
+// infp를 끝까지 읽으며 스트리밍 인코더로 압축하여 outfp에 출력 (파이프/stdin 사용 가능)
+// return value : 성공 1, 실패 0
+int stream_encoding( FILE *infp, FILE *outfp){
+	static unsigned char buf[BITIO_BUFSIZE];
+	HUFF_ENCODER enc;
+	size_t n;
+	int ok = 1;
+
+	if(!huff_encoder_init(&enc, outfp)) return 0;
+
+	while(ok && (n = fread(buf, 1, sizeof(buf), infp)) > 0)
+		ok = huff_encoder_update(&enc, buf, (long)n);
+
+	return huff_encoder_finish(&enc) && ok;
+}
+
+// infp를 끝까지 읽으며 스트리밍 디코더로 해제하여 outfp에 출력 (파이프/stdin 사용 가능)
+// return value : 성공 1, 실패 0
+int stream_decoding( FILE *infp, FILE *outfp){
+	static unsigned char buf[BITIO_BUFSIZE];
+	HUFF_DECODER dec;
+	size_t n;
+	int ok = 1;
+
+	if(!huff_decoder_init(&dec, outfp)) return 0;
+
+	while(ok && (n = fread(buf, 1, sizeof(buf), infp)) > 0)
+		ok = huff_decoder_update(&dec, buf, (long)n);
+
+	ok = huff_decoder_finish(&dec) && ok;
+	if(!ok) fprintf(stderr, "Error : corrupted input!\n");
+
+	return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// xorshift64* 난수 생성기
+static unsigned long long _rand_next( unsigned long long *state){
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// [0, 1) 범위의 실수 난수
+static double _rand_double( unsigned long long *state){
+	return (_rand_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// n개의 순위에 대한 Zipf 분포 누적 확률
+static void _zipf_cdf( double *cdf, int n){
+	double sum = 0;
+
+	for(int r = 0; r < n; ++r){
+		sum += 1.0 / (r + 1);
+		cdf[r] = sum;
+	}
+	for(int r = 0; r < n; ++r)
+		cdf[r] /= sum;
+}
+
+// Zipf 분포로 순위를 뽑음
+static int _zipf_sample( const double *cdf, int n, unsigned long long *state){
+	double u = _rand_double(state);
+	int lo = 0, hi = n - 1;
+
+	while(lo < hi){
+		int mid = (lo + hi) / 2;
+		if(cdf[mid] <= u) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+static const char *_corpus_words[] = {
+	"the", "of", "and", "to", "a", "in", "is", "that", "for", "it",
+	"as", "was", "with", "be", "by", "on", "not", "he", "this", "are",
+	"or", "his", "from", "at", "which", "but", "have", "an", "had", "they",
+	"you", "were", "their", "one", "all", "we", "can", "her", "has", "there",
+	"been", "if", "more", "when", "will", "would", "who", "so", "no", "time",
+	"people", "about", "into", "than", "only", "other", "new", "some", "could", "these",
+	"huffman", "code", "tree", "frequency"
+};
+#define NUM_CORPUS_WORDS	(int)(sizeof(_corpus_words) / sizeof(_corpus_words[0]))
+
+static const char *_corpus_names[NUM_CORPORA] = { "uniform", "zipf", "text", "runs"};
+
+void make_corpus( int kind, unsigned char *data, long size, unsigned long long seed){
+	unsigned long long state = seed * 0x9E3779B97F4A7C15ULL + kind + 1;
+	double cdf[256];
+	long pos = 0;
+
+	if(kind == CORPUS_UNIFORM){
+		for(; pos < size; ++pos)
+			data[pos] = (unsigned char)(_rand_next(&state) >> 56);
+	}
+	else if(kind == CORPUS_ZIPF){
+		_zipf_cdf(cdf, 256);
+		// 순위를 바이트 값에 흩어 놓음 (167은 홀수이므로 256개의 순열)
+		for(; pos < size; ++pos)
+			data[pos] = (unsigned char)(_zipf_sample(cdf, 256, &state) * 167 + 13);
+	}
+	else if(kind == CORPUS_TEXT){
+		int line = 0, capital = 1;
+
+		_zipf_cdf(cdf, NUM_CORPUS_WORDS);
+		while(pos < size){
+			const char *word = _corpus_words[_zipf_sample(cdf, NUM_CORPUS_WORDS, &state)];
+			int r = (int)(_rand_next(&state) % 100);
+
+			for(int i = 0; word[i] != '\0' && pos < size; ++i, ++line)
+				data[pos++] = (unsigned char)((i == 0 && capital) ? word[i] - 'a' + 'A' : word[i]);
+			capital = 0;
+
+			if(r < 7 && pos < size){
+				data[pos++] = '.';
+				capital = 1;
+			}
+			else if(r < 15 && pos < size)
+				data[pos++] = ',';
+
+			if(pos < size){
+				data[pos++] = (line > 72) ? '\n' : ' ';
+				line = (line > 72) ? 0 : line + 1;
+			}
+		}
+	}
+	else{
+		unsigned char palette[8];
+
+		for(int i = 0; i < 8; ++i)
+			palette[i] = (unsigned char)(_rand_next(&state) >> 56);
+
+		while(pos < size){
+			unsigned long long r = _rand_next(&state);
+			long len;
+
+			if((r & 3) == 0){ // 짧은 임의 구간
+				len = 1 + (long)((r >> 8) % 64);
+				for(long i = 0; i < len && pos < size; ++i)
+					data[pos++] = (unsigned char)(_rand_next(&state) >> 56);
+			}
+			else{ // 긴 반복 구간
+				len = 1 + (long)((r >> 8) % 2048);
+				unsigned char value = palette[(r >> 4) & 7];
+				for(long i = 0; i < len && pos < size; ++i)
+					data[pos++] = value;
+			}
+		}
+	}
+}
+
+// 단조 증가하는 시간 (초)
+static double _bench_time( void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 경과 사이클 측정용 카운터 (TSC가 없으면 0)
+static unsigned long long _bench_cycles( void){
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// 최대 RSS를 현재 RSS로 되돌림 (Linux의 /proc/self/clear_refs에 5를 씀)
+// return value : 성공 1, 지원하지 않으면 0
+static int _reset_peak_rss( void){
+	FILE *fp = fopen("/proc/self/clear_refs", "w");
+	int ok;
+
+	if(fp == NULL) return 0;
+	ok = (fputs("5", fp) >= 0);
+	if(fclose(fp) != 0) ok = 0;
+	return ok;
+}
+
+// 최대 RSS (KB) : /proc/self/status의 VmHWM (마지막 _reset_peak_rss 이후의 최고치)
+// VmHWM이 없으면 getrusage로 구한 프로세스 전체의 최고치 (줄어들지 않음)
+static long _peak_rss_kb( void){
+	FILE *fp = fopen("/proc/self/status", "r");
+	char line[256];
+	long kb = -1;
+	struct rusage ru;
+
+	if(fp != NULL){
+		while(fgets(line, sizeof(line), fp) != NULL)
+			if(sscanf(line, "VmHWM: %ld", &kb) == 1) break;
+		fclose(fp);
+	}
+	if(kb >= 0) return kb;
+
+	if(getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+	return ru.ru_maxrss;
+}
+
+// 블록들의 압축 결과 해제
+static void _free_comp( BLOCK *blocks, int n){
+	for(int k = 0; k < n; ++k){
+		free(blocks[k].comp);
+		blocks[k].comp = NULL;
+	}
+}
+
+// 코퍼스 하나를 블록 단위로 인코딩/디코딩하여 결과 한 줄 출력
+// return value : 올바르게 복원되면 1, 아니면 0
+static int _bench_corpus( FILE *outfp, THREAD_POOL *pool, int kind, const unsigned char *data, unsigned char *dec, long size){
+	int n = (int)((size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	BLOCK *blocks = (BLOCK *)calloc(n, sizeof(BLOCK));
+	double enc_time = 0, dec_time = 0;
+	unsigned long long enc_cycles = 0, dec_cycles = 0;
+	long long comp_bytes = 0;
+	int ok = 1;
+
+	if(blocks == NULL) return 0;
+
+	for(int rep = 0; rep < BENCH_REPEAT && ok; ++rep){
+		_free_comp(blocks, n);
+		for(int k = 0; k < n; ++k){
+			blocks[k].raw = (unsigned char *)data + (long)k * BLOCK_SIZE;
+			blocks[k].raw_size = (k == n - 1) ? (int)(size - (long)k * BLOCK_SIZE) : BLOCK_SIZE;
+			blocks[k].error = 0;
+		}
+
+		double t = _bench_time();
+		unsigned long long c = _bench_cycles();
+		pool_run(pool, _encode_block_job, blocks, n);
+		c = _bench_cycles() - c;
+		t = _bench_time() - t;
+
+		if(rep == 0 || t < enc_time){
+			enc_time = t;
+			enc_cycles = c;
+		}
+		for(int k = 0; k < n; ++k)
+			if(blocks[k].error) ok = 0;
+	}
+
+	// block_encoding과 같은 파일 형식의 크기
+	comp_bytes = 4 + sizeof(unsigned int) + sizeof(unsigned int) * (2 * (long long)n + 1) + 4;
+	for(int k = 0; k < n && ok; ++k)
+		comp_bytes += blocks[k].comp_size;
+
+	for(int rep = 0; rep < BENCH_REPEAT && ok; ++rep){
+		memset(dec, 0, size);
+		for(int k = 0; k < n; ++k)
+			blocks[k].raw = dec + (long)k * BLOCK_SIZE;
+
+		double t = _bench_time();
+		unsigned long long c = _bench_cycles();
+		pool_run(pool, _decode_block_job, blocks, n);
+		c = _bench_cycles() - c;
+		t = _bench_time() - t;
+
+		if(rep == 0 || t < dec_time){
+			dec_time = t;
+			dec_cycles = c;
+		}
+		for(int k = 0; k < n; ++k)
+			if(blocks[k].error) ok = 0;
+		if(ok && memcmp(data, dec, size) != 0) ok = 0;
+	}
+
+	_free_comp(blocks, n);
+	free(blocks);
+
+	if(!ok){
+		fprintf(stderr, "Error : %s %ld bytes was not restored!\n", _corpus_names[kind], size);
+		return 0;
+	}
+
+	fprintf(outfp, "%s\t%ld\t%d\t%lld\t%.4f\t%.1f\t%.1f\t%.2f\t%.2f\t%ld\n",
+		_corpus_names[kind], size, pool->num_threads, comp_bytes, (double)comp_bytes / size,
+		size / enc_time / 1e6, size / dec_time / 1e6,
+		(_bench_cycles() == 0) ? NAN : (double)enc_cycles / size,
+		(_bench_cycles() == 0) ? NAN : (double)dec_cycles / size,
+		_peak_rss_kb());
+	fflush(outfp);
+
+	return 1;
+}
+
+int run_benchmark( FILE *outfp, const long *sizes, int num_sizes, int num_threads){
+	THREAD_POOL pool;
+	int ok = 1;
+
+	if(!pool_create(&pool, num_threads)) return 0;
+
+	// 최대 RSS를 줄마다 되돌릴 수 있는지 확인 (안 되면 프로세스 전체의 최고치)
+	int per_row_rss = _reset_peak_rss();
+
+	// 비교할 때 빌드 설정을 구분할 수 있도록 주석 줄로 출력
+	fprintf(outfp, "# block_size=%d code_len_limit=%d interleaved=%d order1=%d repeat=%d rss=%s\n", BLOCK_SIZE, CODE_LEN_LIMIT,
+#ifdef INTERLEAVED_MODE
+		1,
+#else
+		0,
+#endif
+#ifdef ORDER1_MODE
+		1,
+#else
+		0,
+#endif
+		BENCH_REPEAT, per_row_rss ? "per_row" : "cumulative");
+	fprintf(outfp, "corpus\tsize\tthreads\tcomp_size\tratio\tenc_mb_s\tdec_mb_s\tenc_cycles_per_byte\tdec_cycles_per_byte\tpeak_rss_kb\n");
+
+	for(int i = 0; i < num_sizes && ok; ++i){
+		unsigned char *data = (unsigned char *)malloc(sizes[i]);
+		unsigned char *dec = (unsigned char *)malloc(sizes[i]);
+
+		if(data == NULL || dec == NULL){
+			fprintf(stderr, "Error : out of memory!\n");
+			ok = 0;
+		}
+
+		for(int kind = 0; kind < NUM_CORPORA && ok; ++kind){
+			if(per_row_rss) _reset_peak_rss();
+			make_corpus(kind, data, sizes[i], 1);
+			ok = _bench_corpus(outfp, &pool, kind, data, dec, sizes[i]);
+		}
+
+		free(data);
+		free(dec);
+	}
+
+	pool_destroy(&pool);
+	return ok;
+}